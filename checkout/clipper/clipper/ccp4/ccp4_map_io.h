@@ -91,6 +91,11 @@ namespace clipper
     //! export data from NXmap
     template<class T> void export_nxmap( const NXmap<T>& nxmap );
 
+    //! import data to Xmap, reading one section at a time
+    template<class T> void import_xmap_sections( Xmap<T>& xmap ) const;
+    //! import the part of the map inside a grid region to NXmap
+    template<class T> void import_nxmap_region( NXmap<T>& nxmap, const Grid_range& region ) const;
+
     enum ASUerror { ASUCORRECT, ASUINCOMPLETE, ASUINCONSISTENT };
     //! import data to Xmap and check ASU (float/double only)
     template<class T> ASUerror import_xmap_check_asu( Xmap<T>& xmap, T missing ) const;
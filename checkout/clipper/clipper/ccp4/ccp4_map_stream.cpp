@@ -0,0 +1,192 @@
+/* ccp4_map_stream.cpp: streaming import for CCP4 map files */
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+
+
+
+#include "ccp4_map_io.h"
+
+#include <fcntl.h>
+#include <ccp4/cmaplib.h>
+
+
+namespace clipper {
+
+
+namespace {
+
+  // Open the file and get the file-order grid info. orderxyz[i] is the
+  // file axis of the i'th coordinate axis.
+  CMap_io::CMMFile* open_sections( const String& filename, int orderxyz[3], int gfms0[3], int gfms1[3], int& datamode )
+  {
+    CMap_io::CMMFile* file = (CMap_io::CMMFile*)CMap_io::ccp4_cmap_open( filename.c_str(), O_RDONLY );
+    if ( file == NULL ) Message::message( Message_fatal( "CCP4MAPfile: File missing or corrupted: "+filename ) );
+    int orderfms[3], dim[3];
+    CMap_io::ccp4_cmap_get_order( file, orderfms );
+    CMap_io::ccp4_cmap_get_dim( file, dim );
+    CMap_io::ccp4_cmap_get_origin( file, gfms0 );
+    datamode = CMap_io::ccp4_cmap_get_datamode( file );
+    if ( datamode != 0 && datamode != 1 && datamode != 2 ) {
+      CMap_io::ccp4_cmap_close( file );
+      Message::message( Message_fatal( "CCP4MAPfile: unsupported data mode: "+filename ) );
+    }
+    for ( int i = 0; i < 3; i++ ) gfms1[i] = gfms0[i] + dim[i] - 1;
+    for ( int i = 0; i < 3; i++ ) orderxyz[orderfms[i]-1] = i;
+    return file;
+  }
+
+  // Read the next section, converting to float in place. The buffer
+  // holds one section.
+  void read_section( CMap_io::CMMFile* file, const int& datamode, std::vector<float>& section )
+  {
+    const int n = section.size();
+    if ( CMap_io::ccp4_cmap_read_section( file, &section[0] ) != 1 )
+      Message::message( Message_fatal( "CCP4MAPfile: section read failed" ) );
+    // narrower types are expanded from the end, so nothing is overwritten
+    if ( datamode == 0 ) {
+      const unsigned char* s = (const unsigned char*)&section[0];
+      for ( int i = n-1; i >= 0; i-- ) section[i] = float( s[i] );
+    } else if ( datamode == 1 ) {
+      const short* s = (const short*)&section[0];
+      for ( int i = n-1; i >= 0; i-- ) section[i] = float( s[i] );
+    }
+  }
+
+} // anonymous namespace
+
+
+/*! The map is read one section at a time, and each section is
+  copied into the Xmap before the next is read. Memory use is the
+  Xmap plus a single section, rather than the Xmap plus the whole
+  file.
+  \param xmap The Xmap to be imported. */
+template<class T> void CCP4MAPfile::import_xmap_sections( Xmap<T>& xmap ) const
+{
+  if ( mode != READ )
+    Message::message( Message_fatal( "CCP4MAPfile: no file open for read" ) );
+
+  int orderxyz[3], gfms0[3], gfms1[3], datamode;
+  CMap_io::CMMFile* file = open_sections( filename, orderxyz, gfms0, gfms1, datamode );
+
+  xmap.init( spacegroup_, cell_, grid_sam_ );
+  const int n0 = gfms1[0] - gfms0[0] + 1;
+  const int n1 = n0 * ( gfms1[1] - gfms0[1] + 1 );
+  std::vector<float> section( n1 );
+  Xmap_base::Map_reference_coord x( xmap );
+  int index, g[3];
+  for ( g[2] = gfms0[2]; g[2] <= gfms1[2]; g[2]++ ) {
+    read_section( file, datamode, section );
+    index = 0;
+    for ( g[1] = gfms0[1]; g[1] <= gfms1[1]; g[1]++ ) {
+      // step along the fast axis from the start of the row
+      g[0] = gfms0[0];
+      x.set_coord( Coord_grid( g[orderxyz[0]], g[orderxyz[1]], g[orderxyz[2]] ) );
+      for ( int i = 0; i < n0; i++ ) {
+	xmap[x] = T( section[ index++ ] );
+	if      ( orderxyz[0] == 0 ) x.next_u();
+	else if ( orderxyz[1] == 0 ) x.next_v();
+	else                         x.next_w();
+      }
+    }
+  }
+  CMap_io::ccp4_cmap_close( file );
+}
+
+/*! Only the sections which overlap the region are read, and only the
+  points inside it are kept. The NXmap covers the intersection of the
+  region with the map in the file, so a region wider than the map is
+  trimmed to the map. No symmetry is applied.
+  \param nxmap The NXmap to be imported.
+  \param region The grid region to import, in the file grid sampling. */
+template<class T> void CCP4MAPfile::import_nxmap_region( NXmap<T>& nxmap, const Grid_range& region ) const
+{
+  if ( mode != READ )
+    Message::message( Message_fatal( "CCP4MAPfile: no file open for read" ) );
+
+  int orderxyz[3], gfms0[3], gfms1[3], datamode;
+  CMap_io::CMMFile* file = open_sections( filename, orderxyz, gfms0, gfms1, datamode );
+
+  // clip the region to the file extent, in file order
+  int lo[3], hi[3];
+  for ( int i = 0; i < 3; i++ ) {
+    lo[orderxyz[i]] = Util::max( gfms0[orderxyz[i]], region.min()[i] );
+    hi[orderxyz[i]] = Util::min( gfms1[orderxyz[i]], region.max()[i] );
+  }
+  if ( lo[0] > hi[0] || lo[1] > hi[1] || lo[2] > hi[2] ) {
+    CMap_io::ccp4_cmap_close( file );
+    Message::message( Message_fatal( "CCP4MAPfile: region does not overlap the map: "+filename ) );
+  }
+  const Coord_grid c0( lo[orderxyz[0]], lo[orderxyz[1]], lo[orderxyz[2]] );
+  const Coord_grid c1( hi[orderxyz[0]], hi[orderxyz[1]], hi[orderxyz[2]] );
+  nxmap.init( cell_, grid_sam_, Grid_range( c0, c1 ) );
+
+  // skip to the first section needed
+  const int n0 = gfms1[0] - gfms0[0] + 1;
+  const int n1 = n0 * ( gfms1[1] - gfms0[1] + 1 );
+  std::vector<float> section( n1 );
+  if ( CMap_io::ccp4_cmap_seek_section( file, lo[2] - gfms0[2], SEEK_SET ) == EOF ) {
+    CMap_io::ccp4_cmap_close( file );
+    Message::message( Message_fatal( "CCP4MAPfile: section seek failed: "+filename ) );
+  }
+  int g[3];
+  for ( g[2] = lo[2]; g[2] <= hi[2]; g[2]++ ) {
+    read_section( file, datamode, section );
+    for ( g[1] = lo[1]; g[1] <= hi[1]; g[1]++ ) {
+      const float* row = &section[ ( g[1] - gfms0[1] ) * n0 ];
+      for ( g[0] = lo[0]; g[0] <= hi[0]; g[0]++ )
+	nxmap.set_data( Coord_grid( g[orderxyz[0]], g[orderxyz[1]], g[orderxyz[2]] ) - c0, T( row[ g[0] - gfms0[0] ] ) );
+    }
+  }
+  CMap_io::ccp4_cmap_close( file );
+}
+
+
+// compile templates
+
+template void CCP4MAPfile::import_xmap_sections<ftype32>( Xmap<ftype32>& xmap ) const;
+template void CCP4MAPfile::import_nxmap_region<ftype32>( NXmap<ftype32>& nxmap, const Grid_range& region ) const;
+
+template void CCP4MAPfile::import_xmap_sections<ftype64>( Xmap<ftype64>& xmap ) const;
+template void CCP4MAPfile::import_nxmap_region<ftype64>( NXmap<ftype64>& nxmap, const Grid_range& region ) const;
+
+
+} // namespace clipper
@@ -5,6 +5,7 @@
 #define CLIPPER_MINIMOL_H
 
 #include "clipper/minimol/minimol_utils.h"
+#include "clipper/minimol/minimol_compact.h"
 //#include "clipper/minimol/minimol_io.h"
 #include "clipper/minimol/minimol_io_mmdb.h"
 #include "clipper/minimol/minimol_io_seq.h"
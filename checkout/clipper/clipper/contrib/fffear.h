@@ -143,6 +143,52 @@ namespace clipper {
   };
 
 
+  //! Multithreaded FFT-based fffear implementation
+  /*! \ingroup g_fffear
+    The score at each grid point x is the weighted mean squared
+    difference between the map and the search target placed at x:
+    \f[ D(x) = \sum_y w(y) ( \rho(x+y) - t(y) )^2 / \sum_y w(y) \f]
+    so that low values indicate a good fit. The target and weight are
+    sampled onto the map grid using the NX_operator, with the target
+    origin at the grid origin.
+
+    The transforms of the map and the squared map are made once by
+    init(). For each search the target and weight transforms run
+    concurrently, the score terms are combined in reciprocal space in
+    parallel, and a single back-transform gives the score map. When
+    several orientations are searched at once, they are shared between
+    the threads.
+
+    The options are those of FFFear_fft, which gives the same scores.
+    With a Sparse FFT type the back-transform uses the sparse map and
+    is not threaded; it is only available with the FFTW 2 backend. */
+  template<class T> class FFFear_fft_threaded : public FFFear_base<T> {
+  public:
+    enum FFTtype { Default, Normal, Sparse };  //!< FFT backend selection
+    //! constructor
+    FFFear_fft_threaded( const Execution_policy& exec = Execution_policy() ) : ffttype_(Default), exec_(exec) {}
+    //! constructor: takes the target Xmap
+    FFFear_fft_threaded( const Xmap<T>& xmap, const Execution_policy& exec = Execution_policy() ) : ffttype_(Default), exec_(exec) { init( xmap ); }
+    //! initialiser: initialise with the given target Xmap
+    void init( const Xmap<T>& xmap );
+    void set_fft_type( FFTtype type );       //! option: fft backend
+    void set_resolution( Resolution reso );  //! option: resolution cutoff
+    bool operator() ( Xmap<T>& result, const NXmap<T>& srchval, const NXmap<T>& srchwgt, const NX_operator& nxop ) const;  //!< search for given target
+    bool operator() ( Xmap<T>& result, const NXmap<T>& srchval, const NXmap<T>& srchwgt, const RTop_orth& rtop ) const;  //!< search for given target
+    //! search for the given target in several orientations
+    bool operator() ( std::vector<Xmap<T> >& results, const NXmap<T>& srchval, const NXmap<T>& srchwgt, const std::vector<RTop_orth>& rtops ) const;
+  private:
+    class Search;
+    Spacegroup spgr;
+    Cell cell;
+    Grid_sampling grid;
+    FFTmap_p1 rho1, rho2;  //!< transforms of map and squared map
+    FFTtype ffttype_;
+    Resolution reso_;
+    Execution_policy exec_;
+  };
+
+
 } // namespace clipper
 
 #endif
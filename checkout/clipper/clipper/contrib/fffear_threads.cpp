@@ -0,0 +1,307 @@
+/* fffear_threads.cpp: multithreaded fast fragment search */
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+
+
+
+#include "fffear.h"
+#include "../core/map_interp.h"
+
+
+namespace clipper {
+
+
+namespace {
+
+  // combine the score terms: a = c2 * conj(a) - 2 c1 * conj(b)
+  // (written on the real and imaginary parts so that it vectorises)
+  void combine_kernel( ffttype* a, const ffttype* b, const ffttype* c1, const ffttype* c2, const int& begin, const int& end )
+  {
+    for ( int i = 2*begin; i < 2*end; i += 2 ) {
+      const ffttype wr = a[i], wi = -a[i+1];
+      const ffttype tr = b[i], ti = -b[i+1];
+      a[i]   = ( c2[i]*wr - c2[i+1]*wi ) - 2.0 * ( c1[i]*tr - c1[i+1]*ti );
+      a[i+1] = ( c2[i]*wi + c2[i+1]*wr ) - 2.0 * ( c1[i]*ti + c1[i+1]*tr );
+    }
+  }
+
+  // combine the score terms, dropping those beyond the resolution limit
+  class Combine_range {
+  public:
+    Combine_range( FFTmap_p1& w, const FFTmap_p1& wt, const FFTmap_p1& rho1, const FFTmap_p1& rho2, const Cell& cell, const ftype& slim ) : w_(w), wt_(wt), rho1_(rho1), rho2_(rho2), cell_(cell), slim_(slim) {}
+    void operator() ( const int&, const int& begin, const int& end ) const
+    {
+      const Coord_grid c0( 0, 0, 0 );
+      ffttype* a = (ffttype*)&w_.cplx_data( c0 );
+      combine_kernel( a, (const ffttype*)&wt_.cplx_data( c0 ),
+		      (const ffttype*)&rho1_.cplx_data( c0 ), (const ffttype*)&rho2_.cplx_data( c0 ),
+		      begin, end );
+      if ( slim_ <= 0.0 ) return;
+      const Grid_sampling& g = w_.grid_real();
+      for ( int i = begin; i < end; i++ ) {
+	const Coord_grid c = w_.grid_reci().deindex( i );
+	const HKL h( ( c.u() > g.nu()/2 ) ? c.u() - g.nu() : c.u(),
+		     ( c.v() > g.nv()/2 ) ? c.v() - g.nv() : c.v(), c.w() );
+	if ( h.invresolsq( cell_ ) > slim_ ) a[2*i] = a[2*i+1] = 0.0;
+      }
+    }
+  private:
+    FFTmap_p1& w_;
+    const FFTmap_p1& wt_;
+    const FFTmap_p1& rho1_;
+    const FFTmap_p1& rho2_;
+    const Cell& cell_;
+    ftype slim_;
+  };
+
+  // transform two maps concurrently
+  class Forward_pair {
+  public:
+    Forward_pair( FFTmap_p1& m0, FFTmap_p1& m1, const int& nthreads ) : m0_(m0), m1_(m1), nthreads_(nthreads) {}
+    void operator() ( const int&, const int& begin, const int& end ) const
+    {
+      for ( int t = begin; t < end; t++ )
+	( ( t == 0 ) ? m0_ : m1_ ).fft_x_to_h( 1.0, nthreads_ );
+    }
+  private:
+    FFTmap_p1& m0_;
+    FFTmap_p1& m1_;
+    int nthreads_;
+  };
+
+} // anonymous namespace
+
+
+//! One fffear search, using the given number of threads.
+template<class T> class FFFear_fft_threaded<T>::Search {
+public:
+  Search( const FFFear_fft_threaded<T>& parent, const NXmap<T>& srchval, const NXmap<T>& srchwgt ) : p_(parent), srchval_(srchval), srchwgt_(srchwgt) {}
+  void run( Xmap<T>& result, const NX_operator& nxop, const int& nthreads ) const
+  {
+    const Grid_sampling& grid = p_.grid;
+    FFTmap_p1 w( grid ), wt( grid );
+
+    // xtal grid range covering the search target
+    const Grid& ng = srchwgt_.grid();
+    Coord_map m0, m1;
+    for ( int i = 0; i < 8; i++ ) {
+      const Coord_map c( ( i & 1 ) ? ng.nu()-1 : 0, ( i & 2 ) ? ng.nv()-1 : 0, ( i & 4 ) ? ng.nw()-1 : 0 );
+      const Coord_map m = nxop.coord_frac( c ).coord_map( grid );
+      for ( int j = 0; j < 3; j++ ) {
+	m0[j] = ( i == 0 ) ? m[j] : Util::min( m0[j], m[j] );
+	m1[j] = ( i == 0 ) ? m[j] : Util::max( m1[j], m[j] );
+      }
+    }
+    const Coord_grid g0 = m0.floor(), g1 = m1.ceil();
+
+    // sample the weighted target onto the grid
+    ftype sw = 0.0, swtt = 0.0;
+    Coord_grid c;
+    for ( c.u() = g0.u(); c.u() <= g1.u(); c.u()++ )
+      for ( c.v() = g0.v(); c.v() <= g1.v(); c.v()++ )
+	for ( c.w() = g0.w(); c.w() <= g1.w(); c.w()++ ) {
+	  const Coord_map m = nxop.coord_map( c.coord_frac( grid ) );
+	  if ( srchwgt_.template in_map<Interp_linear>( m ) &&
+	       srchval_.template in_map<Interp_linear>( m ) ) {
+	    const ftype wgt = srchwgt_.template interp<Interp_linear>( m );
+	    if ( wgt == 0.0 ) continue;
+	    const ftype val = srchval_.template interp<Interp_linear>( m );
+	    const Coord_grid cu = c.unit( grid );
+	    w.real_data( cu )  += wgt;
+	    wt.real_data( cu ) += wgt * val;
+	    sw   += wgt;
+	    swtt += wgt * val * val;
+	  }
+	}
+    if ( sw <= 0.0 ) Message::message( Message_fatal( "FFFear_fft_threaded: search weights are zero" ) );
+
+    // transform and combine terms
+    const ftype slim = p_.reso_.is_null() ? 0.0 : p_.reso_.invresolsq_limit();
+    parallel_ranges( 2, nthreads, Forward_pair( w, wt, Util::max( nthreads/2, 1 ) ) );
+    parallel_ranges( w.grid_reci().size(), nthreads, Combine_range( w, wt, p_.rho1, p_.rho2, p_.cell, slim ) );
+
+#ifndef CLIPPER_DISABLE_FFTW2
+    // transform back on the result ASU only; the sparse map uses FFTW 2
+    if ( FFTmap_base::default_backend() == FFTmap_base::FFTW2 &&
+	 ( p_.ffttype_ == Sparse ||
+	   ( p_.ffttype_ == Default && Xmap_base::default_type() == Xmap_base::Sparse ) ) ) {
+      FFTmap_sparse_p1_hx sparse( grid );
+      const Grid& gr = w.grid_reci();
+      for ( c.u() = 0; c.u() < gr.nu(); c.u()++ )
+	for ( c.v() = 0; c.v() < gr.nv(); c.v()++ )
+	  for ( c.w() = 0; c.w() < gr.nw(); c.w()++ )
+	    if ( w.cplx_data( c ) != std::complex<ffttype>( 0.0, 0.0 ) )
+	      sparse.cplx_data( c ) = w.cplx_data( c );
+      typename Xmap<T>::Map_reference_index ix;
+      for ( ix = result.first(); !ix.last(); ix.next() )
+	sparse.require_real_data( ix.coord().unit( grid ) );
+      sparse.fft_h_to_x( ftype( grid.size() ) );
+      for ( ix = result.first(); !ix.last(); ix.next() )
+	result[ix] = ( sparse.real_data( ix.coord().unit( grid ) ) + swtt ) / sw;
+      return;
+    }
+#endif
+
+    // transform back
+    w.fft_h_to_x( ftype( grid.size() ), nthreads );
+
+    for ( typename Xmap<T>::Map_reference_index ix = result.first(); !ix.last(); ix.next() )
+      result[ix] = ( w.real_data( ix.coord().unit( grid ) ) + swtt ) / sw;
+  }
+private:
+  const FFFear_fft_threaded<T>& p_;
+  const NXmap<T>& srchval_;
+  const NXmap<T>& srchwgt_;
+};
+
+
+namespace {
+
+  // run a range of searches in each thread
+  template<class T, class S> class Search_tasks {
+  public:
+    Search_tasks( const S& search, std::vector<Xmap<T> >& results, const std::vector<NX_operator>& nxops, const int& nthreads ) : search_(search), results_(results), nxops_(nxops), nthreads_(nthreads) {}
+    void operator() ( const int&, const int& begin, const int& end ) const
+    {
+      for ( int i = begin; i < end; i++ )
+	search_.run( results_[i], nxops_[i], nthreads_ );
+    }
+  private:
+    const S& search_;
+    std::vector<Xmap<T> >& results_;
+    const std::vector<NX_operator>& nxops_;
+    int nthreads_;
+  };
+
+} // anonymous namespace
+
+
+/*! The map and squared map are expanded to P1 and transformed
+  concurrently.
+  \param xmap The map to be searched. */
+template<class T> void FFFear_fft_threaded<T>::init( const Xmap<T>& xmap )
+{
+  spgr = xmap.spacegroup();
+  cell = xmap.cell();
+  grid = xmap.grid_sampling();
+  rho1.init( grid );
+  rho2.init( grid );
+  typename Xmap<T>::Map_reference_coord ix( xmap );
+  Coord_grid c;
+  for ( c.u() = 0; c.u() < grid.nu(); c.u()++ )
+    for ( c.v() = 0; c.v() < grid.nv(); c.v()++ ) {
+      c.w() = 0;
+      ix.set_coord( c );
+      for ( ; c.w() < grid.nw(); c.w()++, ix.next_w() ) {
+	const ffttype r = xmap[ix];
+	rho1.real_data( c ) = r;
+	rho2.real_data( c ) = r * r;
+      }
+    }
+  const int nthd = Util::max( exec_.num_threads(), 1 );
+  parallel_ranges( 2, nthd, Forward_pair( rho1, rho2, Util::max( nthd/2, 1 ) ) );
+}
+
+//! set the FFT type: Sparse transforms back only the result ASU
+template<class T> void FFFear_fft_threaded<T>::set_fft_type( FFTtype type )
+{
+  ffttype_ = type;
+}
+
+/*! Reciprocal space terms beyond the limit are omitted from the
+  score. A null Resolution removes the limit. */
+template<class T> void FFFear_fft_threaded<T>::set_resolution( Resolution reso )
+{
+  reso_ = reso;
+}
+
+/*! \param result The score map.
+  \param srchval The search target.
+  \param srchwgt The search weights.
+  \param nxop The operator relating the target to the map grid. */
+template<class T> bool FFFear_fft_threaded<T>::operator() ( Xmap<T>& result, const NXmap<T>& srchval, const NXmap<T>& srchwgt, const NX_operator& nxop ) const
+{
+  result.init( spgr, cell, grid );
+  Search( *this, srchval, srchwgt ).run( result, nxop, Util::max( exec_.num_threads(), 1 ) );
+  return true;
+}
+
+/*! \param result The score map.
+  \param srchval The search target.
+  \param srchwgt The search weights.
+  \param rtop The operator from the map frame to the target frame. */
+template<class T> bool FFFear_fft_threaded<T>::operator() ( Xmap<T>& result, const NXmap<T>& srchval, const NXmap<T>& srchwgt, const RTop_orth& rtop ) const
+{
+  return (*this)( result, srchval, srchwgt, NX_operator( cell, grid, srchwgt, rtop ) );
+}
+
+/*! The orientations are shared between the threads; any threads
+  beyond one per orientation are used within each search.
+  \param results The score maps, one for each orientation.
+  \param srchval The search target.
+  \param srchwgt The search weights.
+  \param rtops The operators from the map frame to the target frame. */
+template<class T> bool FFFear_fft_threaded<T>::operator() ( std::vector<Xmap<T> >& results, const NXmap<T>& srchval, const NXmap<T>& srchwgt, const std::vector<RTop_orth>& rtops ) const
+{
+  const int n = rtops.size();
+  results.resize( n );
+  std::vector<NX_operator> nxops( n );
+  for ( int i = 0; i < n; i++ ) {
+    results[i].init( spgr, cell, grid );
+    nxops[i].init( cell, grid, srchwgt, rtops[i] );
+  }
+  if ( n == 0 ) return true;
+  const int nthd = Util::max( exec_.num_threads(), 1 );
+  Search search( *this, srchval, srchwgt );
+  parallel_ranges( n, nthd, Search_tasks<T,Search>( search, results, nxops, Util::max( nthd/n, 1 ) ) );
+  return true;
+}
+
+
+// compile templates
+
+template class FFFear_fft_threaded<ftype32>;
+
+template class FFFear_fft_threaded<ftype64>;
+
+
+} // namespace clipper
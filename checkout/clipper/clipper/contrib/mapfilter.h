@@ -105,6 +105,17 @@ namespace clipper {
 
     This would be a useful step in solvent mask determination, for example.
 
+    The forms which take an Execution_policy share the work between
+    threads. Several maps on the same grid may be filtered together,
+    in which case the filter is transformed once and the transforms
+    of the maps run concurrently:
+    \code
+    std::vector<const clipper::Xmap<float>*> maps( 2 );
+    maps[0] = &xmap; maps[1] = &xmap2;
+    std::vector<clipper::Xmap<float> > lstat;
+    fltr( lstat, maps, clipper::Execution_policy( 4 ) );
+    \endcode
+
     \ingroup g_mapf */
   template<class T> class MapFilter_fft : public MapFilter_base<T> {
   public:
@@ -116,6 +127,10 @@ namespace clipper {
     MapFilter_fft( clipper::Xmap<T>& result, const clipper::Xmap<T>& xmap, MapFilterFn_base& fltr, const ftype scale = 1.0, const TYPE type = NONE );
     bool operator() ( clipper::Xmap<T>& result, const clipper::Xmap<T>& xmap ) const;
     bool operator() ( clipper::NXmap<T>& result, const clipper::NXmap<T>& nxmap ) const;
+    //! filter a map using several threads
+    bool operator() ( clipper::Xmap<T>& result, const clipper::Xmap<T>& xmap, const Execution_policy& exec ) const;
+    //! filter several maps on the same grid using several threads
+    bool operator() ( std::vector<clipper::Xmap<T> >& results, const std::vector<const clipper::Xmap<T>*>& xmaps, const Execution_policy& exec ) const;
   private:
     const MapFilterFn_base* fltr_;
     ftype scale_;
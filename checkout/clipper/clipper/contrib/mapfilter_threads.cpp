@@ -0,0 +1,219 @@
+/* mapfilter_threads.cpp: multithreaded radial map filtering */
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+
+
+
+#include "mapfilter.h"
+
+
+namespace clipper {
+
+
+namespace {
+
+  // multiply complex arrays elementwise: a = a * b
+  // (written on the real and imaginary parts so that it vectorises)
+  void cmul_kernel( ffttype* a, const ffttype* b, const int& begin, const int& end )
+  {
+    for ( int i = 2*begin; i < 2*end; i += 2 ) {
+      const ffttype ar = a[i], ai = a[i+1];
+      a[i]   = ar * b[i]   - ai * b[i+1];
+      a[i+1] = ar * b[i+1] + ai * b[i];
+    }
+  }
+
+  class Cmul_range {
+  public:
+    Cmul_range( std::vector<FFTmap_p1>& maps ) : maps_(maps) {}
+    void operator() ( const int&, const int& begin, const int& end ) const
+    {
+      const ffttype* f = (const ffttype*)&maps_[0].cplx_data( Coord_grid(0,0,0) );
+      for ( int m = 1; m < int(maps_.size()); m++ )
+	cmul_kernel( (ffttype*)&maps_[m].cplx_data( Coord_grid(0,0,0) ), f, begin, end );
+    }
+  private:
+    std::vector<FFTmap_p1>& maps_;
+  };
+
+  // task 0 makes the filter, task i > 0 copies map i-1; all transform
+  template<class T> class Forward_tasks {
+  public:
+    Forward_tasks( std::vector<FFTmap_p1>& maps, const std::vector<const Xmap<T>*>& xmaps, const MapFilterFn_base& fltr, ftype& sum, const int& nthreads ) : maps_(maps), xmaps_(xmaps), fltr_(fltr), sum_(sum), nthreads_(nthreads) {}
+    void operator() ( const int&, const int& begin, const int& end ) const
+    {
+      for ( int t = begin; t < end; t++ ) {
+	if ( t == 0 ) make_filter();
+	else          copy_map( *xmaps_[t-1], maps_[t] );
+	maps_[t].fft_x_to_h( 1.0, nthreads_ );
+      }
+    }
+  private:
+    // filter value at the nearest image of every grid offset
+    void make_filter() const
+    {
+      const Cell& cell = xmaps_[0]->cell();
+      const Grid_sampling& grid = xmaps_[0]->grid_sampling();
+      FFTmap_p1& fmap = maps_[0];
+      ftype sum = 0.0;
+      Coord_grid c;
+      for ( c.u() = 0; c.u() < grid.nu(); c.u()++ )
+	for ( c.v() = 0; c.v() < grid.nv(); c.v()++ )
+	  for ( c.w() = 0; c.w() < grid.nw(); c.w()++ ) {
+	    const Coord_grid d( c.u() - ( ( 2*c.u() >= grid.nu() ) ? grid.nu() : 0 ),
+				c.v() - ( ( 2*c.v() >= grid.nv() ) ? grid.nv() : 0 ),
+				c.w() - ( ( 2*c.w() >= grid.nw() ) ? grid.nw() : 0 ) );
+	    const ftype f = fltr_( sqrt( d.coord_frac( grid ).lengthsq( cell ) ) );
+	    fmap.real_data( c ) = f;
+	    sum += f;
+	  }
+      sum_ = sum;
+    }
+    // copy the map into P1, one symmetry lookup per row
+    static void copy_map( const Xmap<T>& xmap, FFTmap_p1& pmap )
+    {
+      const Grid_sampling& grid = xmap.grid_sampling();
+      typename Xmap<T>::Map_reference_coord ix( xmap );
+      Coord_grid c;
+      for ( c.u() = 0; c.u() < grid.nu(); c.u()++ )
+	for ( c.v() = 0; c.v() < grid.nv(); c.v()++ ) {
+	  c.w() = 0;
+	  ix.set_coord( c );
+	  for ( ; c.w() < grid.nw(); c.w()++, ix.next_w() )
+	    pmap.real_data( c ) = xmap[ix];
+	}
+    }
+    std::vector<FFTmap_p1>& maps_;
+    const std::vector<const Xmap<T>*>& xmaps_;
+    const MapFilterFn_base& fltr_;
+    ftype& sum_;
+    int nthreads_;
+  };
+
+  // back-transform map i and copy it into result i
+  template<class T> class Reverse_tasks {
+  public:
+    Reverse_tasks( std::vector<FFTmap_p1>& maps, std::vector<Xmap<T> >& results, const ftype& scale, const int& nthreads ) : maps_(maps), results_(results), scale_(scale), nthreads_(nthreads) {}
+    void operator() ( const int&, const int& begin, const int& end ) const
+    {
+      for ( int t = begin; t < end; t++ ) {
+	FFTmap_p1& pmap = maps_[t+1];
+	Xmap<T>& result = results_[t];
+	pmap.fft_h_to_x( scale_, nthreads_ );
+	for ( typename Xmap<T>::Map_reference_index ix = result.first(); !ix.last(); ix.next() )
+	  result[ix] = pmap.real_data( ix.coord().unit( pmap.grid_real() ) );
+      }
+    }
+  private:
+    std::vector<FFTmap_p1>& maps_;
+    std::vector<Xmap<T> >& results_;
+    ftype scale_;
+    int nthreads_;
+  };
+
+} // anonymous namespace
+
+
+/*! The result is the same as for the single-threaded form.
+  \param result The filtered map.
+  \param xmap The map to be filtered.
+  \param exec The number of threads. */
+template<class T> bool MapFilter_fft<T>::operator() ( Xmap<T>& result, const Xmap<T>& xmap, const Execution_policy& exec ) const
+{
+  std::vector<const Xmap<T>*> xmaps( 1, &xmap );
+  std::vector<Xmap<T> > results;
+  if ( !(*this)( results, xmaps, exec ) ) return false;
+  result = results[0];
+  return true;
+}
+
+/*! The filter is evaluated at every grid offset in the cell (using
+  the nearest lattice image) and transformed once. It is transformed
+  concurrently with the maps, the products are formed in parallel
+  over the reflection grid, and the maps are transformed back
+  concurrently. The maps must all have the same cell and grid.
+  \param results The filtered maps, in the same order as xmaps.
+  \param xmaps The maps to be filtered.
+  \param exec The number of threads. */
+template<class T> bool MapFilter_fft<T>::operator() ( std::vector<Xmap<T> >& results, const std::vector<const Xmap<T>*>& xmaps, const Execution_policy& exec ) const
+{
+  if ( xmaps.empty() ) return false;
+  const Spacegroup& spgr = xmaps[0]->spacegroup();
+  const Cell& cell = xmaps[0]->cell();
+  const Grid_sampling& grid = xmaps[0]->grid_sampling();
+  for ( int i = 1; i < int(xmaps.size()); i++ )
+    if ( xmaps[i]->grid_sampling() != grid || !xmaps[i]->cell().equals( cell ) )
+      Message::message( Message_fatal( "MapFilter_fft: map mismatch" ) );
+
+  const int nthd = Util::max( exec.num_threads(), 1 );
+  const int nmap = xmaps.size();
+  std::vector<FFTmap_p1> maps( nmap + 1 );
+  for ( int i = 0; i <= nmap; i++ ) maps[i].init( grid );
+  results.resize( nmap );
+  for ( int i = 0; i < nmap; i++ ) results[i].init( spgr, cell, grid );
+
+  // transform the filter and the maps concurrently
+  ftype sum = 0.0;
+  parallel_ranges( nmap + 1, nthd, Forward_tasks<T>( maps, xmaps, *fltr_, sum, Util::max( nthd/(nmap+1), 1 ) ) );
+
+  // convolute
+  parallel_ranges( maps[0].grid_reci().size(), nthd, Cmul_range( maps ) );
+
+  // scale and transform back
+  ftype scale = scale_;
+  if ( type_ == Relative )      scale /= sum;
+  else if ( type_ == Absolute ) scale *= cell.volume() / ftype( grid.size() );
+  parallel_ranges( nmap, nthd, Reverse_tasks<T>( maps, results, scale * ftype( grid.size() ), Util::max( nthd/nmap, 1 ) ) );
+  return true;
+}
+
+
+// compile templates
+
+template bool MapFilter_fft<ftype32>::operator() ( Xmap<ftype32>& result, const Xmap<ftype32>& xmap, const Execution_policy& exec ) const;
+template bool MapFilter_fft<ftype32>::operator() ( std::vector<Xmap<ftype32> >& results, const std::vector<const Xmap<ftype32>*>& xmaps, const Execution_policy& exec ) const;
+
+template bool MapFilter_fft<ftype64>::operator() ( Xmap<ftype64>& result, const Xmap<ftype64>& xmap, const Execution_policy& exec ) const;
+template bool MapFilter_fft<ftype64>::operator() ( std::vector<Xmap<ftype64> >& results, const std::vector<const Xmap<ftype64>*>& xmaps, const Execution_policy& exec ) const;
+
+
+} // namespace clipper
@@ -49,6 +49,8 @@
 
 #include "function_object_bases.h"
 
+#include <map>
+
 
 namespace clipper {
 
@@ -109,6 +111,56 @@ namespace clipper {
   };
 
 
+  //! Reusable structure factor calculation by fast Fourier
+  /*! This performs the same calculation as SFcalc_iso_fft, or as
+    SFcalc_aniso_fft if aniso is set, but the FFT grid, the symmetry
+    operators and the per-element Gaussian coefficients are kept
+    between calls. Repeated calculations on the same cell and grid,
+    e.g. for a series of model variants, therefore skip all of the
+    setup.
+
+    The P1 grid is divided into slabs along w, one range of sections
+    for each thread of the execution policy. Each thread spreads the
+    symmetry copies of all the atoms which reach its slab, writing
+    only to its own sections of the shared FFT map. Every grid point
+    is summed in atom order, so the result does not depend on the
+    number of threads, and the FFT uses the threaded transform.
+
+    The object holds mutable workspace and must not be used from
+    several threads at once.
+    \ingroup g_sfcalc */
+  template<class T> class SFcalc_fft_cached : public SFcalc_base<T> {
+  public:
+    //! constructor
+    /*! \param radius Radius in Angstroms over which to calculate atom density.
+        \param rate Shannon rate (oversampling) of the FFT grid.
+        \param uadd Additional U for smoothing atoms.
+        \param aniso Use anisotropic U where available.
+        \param exec Number of threads for density spreading and FFT. */
+    SFcalc_fft_cached( const ftype radius = 2.5, const ftype rate = 1.5, const ftype uadd = 0.0, const bool aniso = false, const Execution_policy& exec = Execution_policy() ) : radius_(radius), rate_(rate), uadd_(uadd), aniso_(aniso), exec_(exec) {}
+    bool operator() ( HKL_data<datatypes::F_phi<T> >& fphidata, const Atom_list& atoms ) const;
+  private:
+    //! Gaussian coefficients for one element
+    struct Gaussians { ftype a[6], b[6]; };
+    //! cell, grid and symmetry dependent data
+    struct Workspace {
+      Spacegroup spgr;
+      Cell cell;
+      Grid_sampling grid;
+      Grid_range box;                              //!< grid offsets covered by an atom
+      std::vector<RTop_orth> symops;               //!< symops in orthogonal coords
+      FFTmap_p1 fftmap;
+      std::map<String, Gaussians> elements;        //!< coefficients by element name
+    };
+    class Spread;
+    void setup( const HKL_info& hkls ) const;
+    const ftype radius_, rate_, uadd_;
+    const bool aniso_;
+    const Execution_policy exec_;
+    mutable Workspace ws;
+  };
+
+
 } // namespace clipper
 
 #endif
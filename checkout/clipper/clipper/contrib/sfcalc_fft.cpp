@@ -0,0 +1,220 @@
+/* sfcalc_fft.cpp: reusable structure factor calculation by FFT */
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+
+
+
+#include "sfcalc.h"
+#include "../core/atomsf.h"
+
+
+namespace clipper {
+
+
+/*! Spreads the density of all the atoms, including their symmetry
+  copies, into a range of w sections of the FFT map. */
+template<class T> class SFcalc_fft_cached<T>::Spread {
+public:
+  Spread( Workspace& ws, const std::vector<const Gaussians*>& coef, const Atom_list& atoms, const ftype& uadd, const bool& aniso ) : ws_(ws), coef_(coef), atoms_(atoms), uadd_(uadd), aniso_(aniso) {}
+  void operator() ( const int&, const int& begin, const int& end ) const;
+private:
+  Workspace& ws_;
+  const std::vector<const Gaussians*>& coef_;
+  const Atom_list& atoms_;
+  const ftype uadd_;
+  const bool aniso_;
+};
+
+template<class T> void SFcalc_fft_cached<T>::Spread::operator() ( const int&, const int& begin, const int& end ) const
+{
+  const Cell& cell = ws_.cell;
+  const Grid_sampling& grid = ws_.grid;
+  const Grid_range& box = ws_.box;
+  FFTmap_p1& fftmap = ws_.fftmap;
+  // orthogonal steps for one grid unit along each axis
+  const Coord_orth eu = Coord_frac( 1.0/grid.nu(), 0.0, 0.0 ).coord_orth( cell );
+  const Coord_orth ev = Coord_frac( 0.0, 1.0/grid.nv(), 0.0 ).coord_orth( cell );
+  const Coord_orth ew = Coord_frac( 0.0, 0.0, 1.0/grid.nw() ).coord_orth( cell );
+  const ftype fourpi2 = 2.0 * Util::twopi2();
+  std::vector<int> iw( box.nw() );
+  ftype aw[6], bw[6];
+  Mat33sym<> vinv[6];
+  for ( int i = 0; i < int(atoms_.size()); i++ ) {
+    const Atom& atom = atoms_[i];
+    if ( atom.is_null() ) continue;
+    const Gaussians& g = *coef_[i];
+    const ftype occ = atom.occupancy();
+    const bool is_aniso = aniso_ && !atom.u_aniso_orth().is_null();
+    if ( !is_aniso ) {
+      // isotropic coefficients do not depend on the symop
+      for ( int j = 0; j < 6; j++ ) {
+        // avoid a delta function for a zero B
+        const ftype b = Util::max( g.b[j] + fourpi2 * 2.0 * ( atom.u_iso() + uadd_ ), 1.0 );
+        aw[j] = occ * g.a[j] * pow( 2.0 * Util::twopi() / b, 1.5 );
+        bw[j] = -fourpi2 / b;
+      }
+    }
+    for ( int s = 0; s < int(ws_.symops.size()); s++ ) {
+      const Coord_orth xyz = ws_.symops[s] * atom.coord_orth();
+      const Coord_grid gc = xyz.coord_frac( cell ).coord_grid( grid );
+      const Coord_grid g0 = gc + box.min();
+      const Coord_grid g1 = gc + box.max();
+      // skip symmetry copies which do not reach this slab
+      const int w0 = Util::mod( g0.w(), grid.nw() );
+      const int w1 = w0 + box.nw() - 1;
+      if ( box.nw() < grid.nw() &&
+           !( ( w0 < end && w1 >= begin ) || w1 - grid.nw() >= begin ) ) continue;
+      if ( is_aniso ) {
+        const U_aniso_orth u = atom.u_aniso_orth().transform( ws_.symops[s] );
+        for ( int j = 0; j < 6; j++ ) {
+          const ftype ui = Util::max( g.b[j] / ( fourpi2 * 2.0 ), 0.0 ) + uadd_;
+          const Mat33sym<> v( u.mat00()+ui, u.mat11()+ui, u.mat22()+ui,
+                              u.mat01(), u.mat02(), u.mat12() );
+          const ftype det = v.det();
+          if ( det > 0.0 ) {
+            vinv[j] = v.inverse();
+            aw[j] = occ * g.a[j] / sqrt( pow( Util::twopi(), 3 ) * det );
+          } else {
+            vinv[j] = Mat33sym<>( 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 );
+            aw[j] = 0.0;
+          }
+        }
+      }
+      for ( int w = g0.w(); w <= g1.w(); w++ ) iw[w-g0.w()] = Util::mod( w, grid.nw() );
+      const Coord_orth d0 = g0.coord_frac( grid ).coord_orth( cell ) - xyz;
+      for ( int u = g0.u(); u <= g1.u(); u++ ) {
+        const int iu = Util::mod( u, grid.nu() );
+        const Coord_orth du = d0 + ftype( u - g0.u() ) * eu;
+        for ( int v = g0.v(); v <= g1.v(); v++ ) {
+          const int iv = Util::mod( v, grid.nv() );
+          ffttype* row = &fftmap.real_data( Coord_grid( iu, iv, 0 ) );
+          Coord_orth d = du + ftype( v - g0.v() ) * ev;
+          for ( int k = 0; k < box.nw(); k++, d = d + ew ) {
+            if ( iw[k] < begin || iw[k] >= end ) continue;
+            ftype rho = 0.0;
+            if ( is_aniso ) {
+              for ( int j = 0; j < 6; j++ )
+                rho += aw[j] * exp( -0.5 * vinv[j].quad_form( d ) );
+            } else {
+              const ftype r2 = d * d;
+              for ( int j = 0; j < 6; j++ )
+                rho += aw[j] * exp( bw[j] * r2 );
+            }
+            row[ iw[k] ] += ffttype( rho );
+          }
+        }
+      }
+    }
+  }
+}
+
+
+/*! The workspace is rebuilt only if the spacegroup, cell or grid
+  differ from those of the previous call. */
+template<class T> void SFcalc_fft_cached<T>::setup( const HKL_info& hkls ) const
+{
+  const Spacegroup& spgr = hkls.spacegroup();
+  const Cell& cell = hkls.cell();
+  const Grid_sampling grid( spgr, cell, hkls.resolution(), rate_ );
+  if ( !ws.spgr.is_null() && ws.spgr.hash() == spgr.hash() &&
+       ws.cell.equals( cell, 0.0001 ) && ws.grid == grid ) return;
+  ws.spgr = spgr;
+  ws.cell = cell;
+  ws.grid = grid;
+  ws.box = Grid_range( cell, grid, radius_ );
+  ws.symops.resize( spgr.num_symops() );
+  for ( int s = 0; s < spgr.num_symops(); s++ )
+    ws.symops[s] = spgr.symop(s).rtop_orth( cell );
+  ws.fftmap.init( grid );
+}
+
+
+template<class T> bool SFcalc_fft_cached<T>::operator() ( HKL_data<datatypes::F_phi<T> >& fphidata, const Atom_list& atoms ) const
+{
+  setup( fphidata.base_hkl_info() );
+  const Grid_sampling& grid = ws.grid;
+
+  // look up scattering factors once per element
+  std::vector<const Gaussians*> coef( atoms.size(), (const Gaussians*)NULL );
+  for ( int i = 0; i < int(atoms.size()); i++ ) if ( !atoms[i].is_null() ) {
+    typename std::map<String,Gaussians>::iterator it = ws.elements.find( atoms[i].element() );
+    if ( it == ws.elements.end() ) {
+      const ScatteringFactorsData& sf = ScatteringFactors::instance()[ atoms[i].element() ];
+      Gaussians g;
+      for ( int j = 0; j < 6; j++ ) { g.a[j] = sf.a[j]; g.b[j] = sf.b[j]; }
+      it = ws.elements.insert( std::make_pair( atoms[i].element(), g ) ).first;
+    }
+    coef[i] = &it->second;
+  }
+
+  // spread the atoms into w slabs of the map, one slab per thread
+  const int nthd = Util::max( Util::min( exec_.num_threads(), grid.nw() ), 1 );
+  ws.fftmap.reset();
+  parallel_ranges( grid.nw(), nthd, Spread( ws, coef, atoms, uadd_, aniso_ ) );
+
+  // calc structure factors from map by fft
+  ws.fftmap.fft_x_to_h( ws.cell.volume(), exec_.num_threads() );
+  HKL_info::HKL_reference_index ih;
+  for ( ih = fphidata.first(); !ih.last(); ih.next() ) {
+    std::complex<ffttype> f = ws.fftmap.get_hkl( ih.hkl() );
+    fphidata[ih].f() = std::abs( f );
+    fphidata[ih].phi() = std::arg( f );
+  }
+
+  // remove the smoothing temperature factor
+  if ( uadd_ != 0.0 ) {
+    ftype u = uadd_ * Util::twopi2();
+    for ( ih = fphidata.first(); !ih.last(); ih.next() )
+      fphidata[ih].f() *= exp( u * ih.invresolsq() );
+  }
+  return true;
+}
+
+
+// compile templates
+
+template class SFcalc_fft_cached<ftype32>;
+
+template class SFcalc_fft_cached<ftype64>;
+
+
+} // namespace clipper
@@ -48,6 +48,7 @@
 
 #include "clipper_thread.h"
 #include <vector>
+#include <atomic>
 
 
 namespace clipper
@@ -186,6 +187,202 @@ namespace clipper
   // for template implementations, see clipper_instance.cpp
 
 
+  //! Sharded object cache manager
+  /*! This is a replacement for ObjectCache with the same interface,
+    intended for programs which construct many maps or reflection
+    lists concurrently. The cached objects are distributed over a
+    number of shards by the hash code of their key, each shard with
+    its own lock, so that threads looking up different objects rarely
+    contend. Reference counts are atomic, so that copying and
+    discarding a Reference takes no lock, except when the last
+    reference to an object is discarded in MINMEM mode.
+
+    In addition to the requirements of ObjectCache, the key type must
+    implement a method 'hash()' returning an unsigned int, which must
+    be equal for any two keys which match the same object.
+
+    Counts of cache hits, misses and evictions are kept for tuning
+    the garbage collection mode.
+
+    The sharded cache is opt-in. The caches held by ClipperInstance,
+    and the cache references in Spacegroup, Xmap_base and
+    HKL_data_base, remain ObjectCache, so that the layout of those
+    classes is unchanged. debug() is compiled for the Spgr_cacheobj,
+    Xmap_cacheobj and HKL_data_cacheobj types. */
+  template<class T> class ObjectCache_sharded
+  {
+  private:
+    class Shard;
+    //! cache entry: object, reference count, and owning shard
+    class Entry
+    {
+    public:
+      Entry( const typename T::Key& key, Shard* shard ) :
+        count(0), data(key), shard_(shard) {}
+      std::atomic<int> count;
+      T data;
+      Shard* shard_;
+    };
+    //! cache shard: a locked list of entries
+    class Shard
+    {
+    public:
+      Mutex mutex;
+      std::vector<Entry*> entries;
+      ObjectCache_sharded<T>* cache_;
+    };
+
+  public:
+    //! ObjectCache_sharded reference class
+    class Reference
+    {
+    public:
+      Reference()                         : obj_(NULL) {}
+      Reference( const Reference& other ) : obj_(other.obj_)
+        { if ( obj_ != NULL ) obj_->count++; }
+      ~Reference() { release(); }
+      void operator =( const Reference& other )
+      {
+        if ( other.obj_ != NULL ) other.obj_->count++;
+        release();
+        obj_ = other.obj_;
+      }
+      bool is_null() const  { return obj_ == NULL; }
+      const T& data() const { return obj_->data; }
+    private:
+      Entry* obj_;
+      //! unsafe constructor (shard must be locked)
+      Reference( Entry* obj ) : obj_(obj) { obj_->count++; }
+      //! drop the reference, collecting the object in MINMEM mode
+      void release()
+      {
+        if ( obj_ == NULL ) return;
+        Shard* shard = obj_->shard_;
+        if ( --obj_->count == 0 && shard->cache_->mode_ == MINMEM ) {
+          shard->mutex.lock();
+          shard->cache_->collect( *shard, obj_ );
+          shard->mutex.unlock();
+        }
+        obj_ = NULL;
+      }
+
+      friend class ObjectCache_sharded<T>;
+    };
+
+    enum MODE { NORMAL, MINMEM, MAXMEM };  //!< garbage collection mode
+    //! constructor
+    ObjectCache_sharded() : mode_(NORMAL), hits_(0), misses_(0), evictions_(0)
+      { for ( int s = 0; s < nshard; s++ ) shards_[s].cache_ = this; }
+    //! destructor, can message on contents
+    ~ObjectCache_sharded() { purge(); }
+    //! set garbage collection mode
+    void set_mode( const MODE& mode ) { mode_ = mode; }
+    //! purge unreferenced objects from cache
+    void purge()
+    {
+      for ( int s = 0; s < nshard; s++ ) {
+        shards_[s].mutex.lock();
+        collect( shards_[s], NULL );
+        shards_[s].mutex.unlock();
+      }
+    }
+    //! VERY DANGEROUS, DO NOT USE
+    void destroy()
+    {
+      for ( int s = 0; s < nshard; s++ ) {
+        shards_[s].mutex.lock();
+        for ( size_t i = 0; i < shards_[s].entries.size(); i++ )
+          delete shards_[s].entries[i];
+        shards_[s].entries.clear();
+        shards_[s].mutex.unlock();
+      }
+    }
+    //! print the cache contents and statistics
+    void debug() const;
+    //! cache or return data by key
+    /*! A new object is constructed without holding the shard lock,
+      since construction may involve expensive precalculation. If
+      another thread has cached a matching object in the meantime,
+      that one is used and the new one is discarded. */
+    Reference cache( const typename T::Key& key )
+    {
+      Shard& shard = shards_[ key.hash() % nshard ];
+      shard.mutex.lock();
+      Entry* ptr = find( shard, key );
+      if ( ptr != NULL ) {
+        hits_++;
+        Reference result( ptr );
+        shard.mutex.unlock();
+        return result;
+      }
+      shard.mutex.unlock();
+      // make the new object outside the lock
+      Entry* made = new Entry( key, &shard );
+      Entry* discard = NULL;
+      shard.mutex.lock();
+      ptr = find( shard, key );
+      if ( ptr != NULL ) {
+        hits_++;
+        discard = made;
+      } else {
+        misses_++;
+        ptr = made;
+        // replace an unreferenced object, or else add to the list
+        size_t i = 0;
+        if ( mode_ == NORMAL )
+          for ( ; i < shard.entries.size(); i++ )
+            if ( shard.entries[i]->count == 0 ) break;
+        if ( mode_ == NORMAL && i < shard.entries.size() ) {
+          discard = shard.entries[i];
+          shard.entries[i] = ptr;
+          evictions_++;
+        } else {
+          shard.entries.push_back( ptr );
+        }
+      }
+      Reference result( ptr );
+      shard.mutex.unlock();
+      delete discard;
+      return result;
+    }
+    //! return the number of lookups which found an existing object
+    long hits() const      { return hits_; }
+    //! return the number of lookups which created a new object
+    long misses() const    { return misses_; }
+    //! return the number of objects removed by garbage collection
+    long evictions() const { return evictions_; }
+
+  private:
+    //! find an entry matching the key (shard must be locked)
+    static Entry* find( const Shard& shard, const typename T::Key& key )
+    {
+      for ( size_t i = 0; i < shard.entries.size(); i++ )
+        if ( shard.entries[i]->data.matches( key ) ) return shard.entries[i];
+      return NULL;
+    }
+    //! delete unreferenced entries, or just one (shard must be locked)
+    void collect( Shard& shard, const Entry* only )
+    {
+      size_t j = 0;
+      for ( size_t i = 0; i < shard.entries.size(); i++ ) {
+        Entry* e = shard.entries[i];
+        if ( e->count == 0 && ( only == NULL || only == e ) ) {
+          delete e;
+          evictions_++;
+        } else {
+          shard.entries[j++] = e;
+        }
+      }
+      shard.entries.resize( j );
+    }
+
+    static const int nshard = 16;     //!< number of shards
+    Shard shards_[nshard];            //!< the shards
+    std::atomic<int> mode_;           //!< the garbage collection mode
+    std::atomic<long> hits_, misses_, evictions_;  //!< statistics
+  };
+
+
 } // namespace clipper
 
 #endif
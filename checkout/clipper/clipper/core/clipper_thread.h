@@ -49,6 +49,8 @@
 #include "clipper_message.h"
 #include "clipper_sysdep.h"
 
+#include <vector>
+
 
 namespace clipper
 {
@@ -158,6 +160,66 @@ public:
 #endif
 
 
+  //! Execution policy for threaded loops
+  /*! Passing an Execution_policy to a method (e.g. HKL_data::compute()
+    or HKL_data::reduce()) splits the work into contiguous index
+    ranges, one per thread. The operators must be safe to call
+    concurrently, i.e. pure per-element functions. */
+  class Execution_policy
+  {
+  public:
+    //! constructor: number of threads (<=1 means serial)
+    explicit Execution_policy( const int& nthreads = 1 ) : nthreads_(nthreads) {}
+    //! number of threads
+    const int& num_threads() const { return nthreads_; }
+  private:
+    int nthreads_;
+  };
+
+
+  //! Thread which processes one sub-range of a parallel loop
+  /*! Used by parallel_ranges(). The functor is called as
+    f( chunk, begin, end ). */
+  template<class F> class Thread_range : public Thread_base {
+  public:
+    Thread_range( const F& f, const int& chunk, const int& begin, const int& end ) : f_(&f), chunk_(chunk), begin_(begin), end_(end) {}
+    //! process the range in the calling thread
+    void run_here() { Run(); }
+  protected:
+    void Run() { (*f_)( chunk_, begin_, end_ ); }
+  private:
+    const F* f_;
+    int chunk_, begin_, end_;
+  };
+
+  //! Split the range [0,n) into contiguous chunks and process them concurrently
+  /*! The range is divided into (at most) nthreads chunks of nearly
+    equal size, and f( chunk, begin, end ) is called for each chunk,
+    the first one in the calling thread. The functor must be safe to
+    call concurrently on disjoint ranges. With nthreads <= 1, or if
+    threads are disabled, f( 0, 0, n ) is called directly.
+    \param n Size of the range.
+    \param nthreads Number of chunks/threads.
+    \param f Functor called for each chunk. */
+  template<class F> void parallel_ranges( const int& n, const int& nthreads, const F& f )
+  {
+    int nt = ( nthreads < n ) ? nthreads : n;
+    if ( nt <= 1 ) { f( 0, 0, n ); return; }
+    std::vector<Thread_range<F>*> threads( nt );
+    std::vector<bool> started( nt, false );
+    for ( int i = 0; i < nt; i++ )
+      threads[i] = new Thread_range<F>( f, i, int( (long long)n*i/nt ),
+					int( (long long)n*(i+1)/nt ) );
+    for ( int i = 1; i < nt; i++ ) started[i] = threads[i]->run();
+    threads[0]->run_here();
+    for ( int i = 1; i < nt; i++ ) {
+      if ( started[i] ) threads[i]->join();
+      else              threads[i]->run_here();  // thread creation failed
+    }
+    for ( int i = 0; i < nt; i++ ) delete threads[i];
+  }
+
+
 } // namespace clipper
 
 #endif
@@ -48,6 +48,8 @@
 
 #include "coords.h"
 
+#include <atomic>
+
 #include <complex>
 
 
@@ -61,12 +63,68 @@ namespace clipper
     template<class T> class F_phi;
   }
 
+  class FFTengine;
+
   // base class for FFT classes
   class FFTmap_base {
   public:
     enum FFTtype { Default, Measure, Estimate };  //!< optimisation options
+    enum FFTbackend { FFTW2, PocketFFT };         //!< transform libraries
+    //! set default number of threads for threaded transforms
+    static void set_default_threads( const int& n ) { default_threads_ = n; }
+    //! get default number of threads for threaded transforms
+    static int default_threads() { return default_threads_; }
+    //! set default transform library for threaded transforms
+    static void set_default_backend( const FFTbackend& b ) { default_backend_ = b; }
+    //! get default transform library for threaded transforms
+    static FFTbackend default_backend() { return default_backend_; }
+    //! return the transform engine for a given library
+    static const FFTengine& engine( const FFTbackend& backend );
+    //! destroy all cached plans (no transforms may be running)
+    static void clear_plans();
   protected:
     static CLIPPER_DL_IMPORT(Mutex) mutex;                 //!< Thread safety
+    static CLIPPER_DL_IMPORT(std::atomic<int>) default_threads_;  //!< default threads
+    static CLIPPER_DL_IMPORT(std::atomic<FFTbackend>) default_backend_;  //!< default library
+  };
+
+  //! FFTengine: abstract base for 3d real/hermitian transform libraries
+  /*! An engine performs unnormalised in-place transforms on data
+    stored as in FFTmap_p1: the real data is nu*nv*(2*(nw/2+1)) with
+    padded rows, and the hermitian data is nu*nv*(nw/2+1) complex
+    values occupying the same memory. The sign conventions are those
+    of FFTW, i.e. the hermitian to real transform is the backward
+    transform. Engines must be safe to use from several threads at
+    once. */
+  class FFTengine : public FFTmap_base {
+  public:
+    virtual ~FFTengine() {}
+    //! in-place hermitian to real transform on the given real grid
+    virtual void fft_h_to_x( const Grid& grid, std::complex<ffttype>* data, const FFTtype& type, const int& nthreads ) const = 0;
+    //! in-place real to hermitian transform on the given real grid
+    virtual void fft_x_to_h( const Grid& grid, ffttype* data, const FFTtype& type, const int& nthreads ) const = 0;
+  };
+
+#ifndef CLIPPER_DISABLE_FFTW2
+  //! FFTW 2 engine, using the plan cache and the FFTW threads library
+  /*! Not available when built with CLIPPER_DISABLE_FFTW2
+    (configure --disable-fftw2). */
+  class FFTengine_fftw2 : public FFTengine {
+  public:
+    void fft_h_to_x( const Grid& grid, std::complex<ffttype>* data, const FFTtype& type, const int& nthreads ) const;
+    void fft_x_to_h( const Grid& grid, ffttype* data, const FFTtype& type, const int& nthreads ) const;
+    //! destroy all cached plans (used by clear_plans())
+    static void destroy_plans();
+  };
+#endif
+
+  //! pocketfft engine, using the header-only library bundled with gemmi
+  /*! pocketfft caches its own twiddle factors and needs no planning
+    or locking, so the optimisation type is ignored. */
+  class FFTengine_pocketfft : public FFTengine {
+  public:
+    void fft_h_to_x( const Grid& grid, std::complex<ffttype>* data, const FFTtype& type, const int& nthreads ) const;
+    void fft_x_to_h( const Grid& grid, ffttype* data, const FFTtype& type, const int& nthreads ) const;
   };
 
   //! FFTmap_p1: low level P1 map used for calculating FFTs
@@ -76,6 +134,15 @@ namespace clipper
     must be non-negative and in range. The first and last sections
     along the half-length direction only have half the elements
     stored, the contents of the other half is ignored.
+
+    The transforms which take a thread count are performed by the
+    FFTengine for default_backend(). The FFTW 2 engine uses plans from
+    a process-wide cache keyed by grid, direction and optimisation
+    type, so that only the first transform on a given grid pays for
+    planning; more than one thread requires the FFTW threads
+    library. The cache holds a limited number of plans, and the least
+    recently used idle plan is destroyed to make room for a new one.
+    If the thread count is zero, default_threads() is used.
   */
   class FFTmap_p1 : public FFTmap_base
   {
@@ -104,6 +171,10 @@ namespace clipper
     void fft_h_to_x( const ftype& scale );
     //! Transform to reciprocal space
     void fft_x_to_h( const ftype& scale );
+    //! Transform to real space using cached plans and threads
+    void fft_h_to_x( const ftype& scale, const int& nthreads );
+    //! Transform to reciprocal space using cached plans and threads
+    void fft_x_to_h( const ftype& scale, const int& nthreads );
 
     //! get reciprocal space data: slow form with hemisphere check
     std::complex<ffttype> get_hkl( const HKL& hkl ) const;
@@ -150,6 +221,42 @@ namespace clipper
   };
 
 
+  //! FFTmap_workspace: reusable P1 map for repeated transforms
+  /*! This holds an FFTmap_p1 which is kept between transforms, so
+    that repeated transforms on the same grid (e.g. in an iterative
+    map improvement loop) do not reallocate the map data. The map
+    depends only on the grid, so one workspace may be shared by maps
+    with different cells or spacegroups; it is reallocated only when
+    the grid changes. Transforms use the cached plans and the given
+    number of threads.
+
+    A workspace may only be used by one thread at a time.
+  */
+  class FFTmap_workspace
+  {
+  public:
+    //! constructor: takes number of threads (0 for default_threads())
+    explicit FFTmap_workspace( const int& nthreads = 0 ) : nthreads_(nthreads), init_(false) {}
+    //! return the zeroed P1 map for the given grid
+    FFTmap_p1& fftmap( const Grid_sampling& grid_sam )
+      {
+	if ( !init_ || fftmap_.grid_real() != grid_sam ) {
+	  fftmap_.init( grid_sam );
+	  init_ = true;
+	} else {
+	  fftmap_.reset();
+	}
+	return fftmap_;
+      }
+    //! number of threads for transforms
+    const int& num_threads() const { return nthreads_; }
+  private:
+    FFTmap_p1 fftmap_;
+    int nthreads_;
+    bool init_;
+  };
+
+
   //! FFTmap: P1 map with symmetry used for calculating FFTs
   /*! The FFTmap is represented in P1 in memory. However, it also has
     a spacegroup, and the contained data remains consistent with this
@@ -184,6 +291,10 @@ namespace clipper
     void fft_h_to_x();
     //! Transform to reciprocal space
     void fft_x_to_h();
+    //! Transform to real space using cached plans and threads
+    void fft_h_to_x( const int& nthreads );
+    //! Transform to reciprocal space using cached plans and threads
+    void fft_x_to_h( const int& nthreads );
 
     //! get reciprocal space data
     template<class T> void get_recip_data( const HKL& rfl, datatypes::F_phi<T>& fphi ) const;
@@ -240,7 +351,7 @@ namespace clipper
       set_recip_data( ih.hkl(), h[ih] );
 
     // fft
-    fft_h_to_x();
+    fft_h_to_x( default_threads() );
 
     // and copy into the map
     typename X::Map_reference_index ix;
@@ -272,7 +383,7 @@ namespace clipper
       set_real_data( ix.coord(), x[ix] );
 
     // fft
-    fft_x_to_h();
+    fft_x_to_h( default_threads() );
 
     // now fill it
     typename H::HKL_reference_index ih;
@@ -0,0 +1,208 @@
+/* fftmap_fftw2.cpp: FFTW 2 engine for P1 fft map */
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+
+#include "fftmap.h"
+
+#ifndef CLIPPER_DISABLE_FFTW2
+
+#ifdef FFTW2_PREFIX_S
+# include <srfftw.h>
+# ifdef FFTW2_THREADS
+#  include <srfftw_threads.h>
+# endif
+#else
+# include <rfftw.h>
+# ifdef FFTW2_THREADS
+#  include <rfftw_threads.h>
+# endif
+#endif
+
+#include <mutex>
+
+
+namespace clipper {
+
+
+/* Plan cache. The plans are created with FFTW_THREADSAFE, so that
+   they are read-only once created and each execution allocates its
+   own work array; one plan then serves every map on the same grid,
+   even when several maps are transformed at once. The cache holds at
+   most fftplan_cache_max plans: when it is full, the least recently
+   used plan which no transform is executing is destroyed. The cache
+   and the FFTW planner are protected by FFTmap_base::mutex, which
+   must be held by the caller. */
+
+class FFTplan_cache_entry {
+public:
+  int nu, nv, nw, dir;
+  bool measure;
+  int users;             // number of transforms executing the plan
+  unsigned long used;    // time of last use
+  rfftwnd_plan plan;
+};
+
+static const size_t fftplan_cache_max = 16;
+static std::vector<FFTplan_cache_entry> fftplan_cache;
+static unsigned long fftplan_clock = 0;
+#ifdef FFTW2_THREADS
+static std::once_flag fftplan_threads_once;
+static bool fftplan_threads_ok = false;
+
+// initialise the FFTW threads library on first use
+static bool fftplan_threads_init()
+{
+  std::call_once( fftplan_threads_once,
+		  [] { fftplan_threads_ok = ( fftw_threads_init() == 0 ); } );
+  return fftplan_threads_ok;
+}
+#endif
+
+// get a plan from the cache, creating it if necessary
+static rfftwnd_plan fftplan_acquire( const Grid& g, const fftw_direction dir, const FFTmap_base::FFTtype type )
+{
+  bool measure = ( type == FFTmap_base::Measure );
+  for ( size_t i = 0; i < fftplan_cache.size(); i++ ) {
+    FFTplan_cache_entry& e = fftplan_cache[i];
+    if ( e.nu == g.nu() && e.nv == g.nv() && e.nw == g.nw() &&
+	 e.dir == int(dir) && e.measure == measure ) {
+      e.users++;
+      e.used = ++fftplan_clock;
+      return e.plan;
+    }
+  }
+  // make room by destroying the least recently used idle plan
+  if ( fftplan_cache.size() >= fftplan_cache_max ) {
+    size_t lru = fftplan_cache.size();
+    for ( size_t i = 0; i < fftplan_cache.size(); i++ )
+      if ( fftplan_cache[i].users == 0 &&
+	   ( lru == fftplan_cache.size() ||
+	     fftplan_cache[i].used < fftplan_cache[lru].used ) ) lru = i;
+    if ( lru < fftplan_cache.size() ) {
+      rfftwnd_destroy_plan( fftplan_cache[lru].plan );
+      fftplan_cache.erase( fftplan_cache.begin() + lru );
+    }
+  }
+  int flags = FFTW_IN_PLACE | FFTW_USE_WISDOM | FFTW_THREADSAFE |
+    ( measure ? FFTW_MEASURE : FFTW_ESTIMATE );
+  FFTplan_cache_entry e;
+  e.nu = g.nu(); e.nv = g.nv(); e.nw = g.nw();
+  e.dir = int(dir); e.measure = measure;
+  e.users = 1;
+  e.used = ++fftplan_clock;
+  e.plan = rfftw3d_create_plan( e.nu, e.nv, e.nw, dir, flags );
+  fftplan_cache.push_back( e );
+  return e.plan;
+}
+
+// return a plan to the cache once the transform is done
+static void fftplan_release( const rfftwnd_plan plan )
+{
+  for ( size_t i = 0; i < fftplan_cache.size(); i++ )
+    if ( fftplan_cache[i].plan == plan ) {
+      fftplan_cache[i].users--;
+      return;
+    }
+}
+
+
+/*! All plans held in the cache are destroyed. This must not be
+  called while any cached-plan transform is running. */
+void FFTengine_fftw2::destroy_plans()
+{
+  mutex.lock();
+  for ( size_t i = 0; i < fftplan_cache.size(); i++ )
+    rfftwnd_destroy_plan( fftplan_cache[i].plan );
+  fftplan_cache.clear();
+  mutex.unlock();
+}
+
+
+/*! \param grid The real space grid.
+  \param data The hermitian data, transformed in place.
+  \param type The optimisation type for planning.
+  \param nthreads The number of threads. */
+void FFTengine_fftw2::fft_h_to_x( const Grid& grid, std::complex<ffttype>* data, const FFTtype& type, const int& nthreads ) const
+{
+  mutex.lock();
+  rfftwnd_plan plan = fftplan_acquire( grid, FFTW_COMPLEX_TO_REAL, type );
+  mutex.unlock();
+#ifdef FFTW2_THREADS
+  if ( nthreads > 1 && fftplan_threads_init() )
+    rfftwnd_threads_one_complex_to_real( nthreads, plan, (fftw_complex*)data, NULL );
+  else
+#else
+  (void)nthreads;
+#endif
+    rfftwnd_one_complex_to_real( plan, (fftw_complex*)data, NULL );
+  mutex.lock();
+  fftplan_release( plan );
+  mutex.unlock();
+}
+
+
+/*! \param grid The real space grid.
+  \param data The real data, transformed in place.
+  \param type The optimisation type for planning.
+  \param nthreads The number of threads. */
+void FFTengine_fftw2::fft_x_to_h( const Grid& grid, ffttype* data, const FFTtype& type, const int& nthreads ) const
+{
+  mutex.lock();
+  rfftwnd_plan plan = fftplan_acquire( grid, FFTW_REAL_TO_COMPLEX, type );
+  mutex.unlock();
+#ifdef FFTW2_THREADS
+  if ( nthreads > 1 && fftplan_threads_init() )
+    rfftwnd_threads_one_real_to_complex( nthreads, plan, (fftw_real*)data, NULL );
+  else
+#else
+  (void)nthreads;
+#endif
+    rfftwnd_one_real_to_complex( plan, (fftw_real*)data, NULL );
+  mutex.lock();
+  fftplan_release( plan );
+  mutex.unlock();
+}
+
+
+} // namespace clipper
+
+#endif
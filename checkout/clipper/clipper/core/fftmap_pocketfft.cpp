@@ -0,0 +1,97 @@
+/* fftmap_pocketfft.cpp: pocketfft engine for P1 fft map */
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+
+#include "fftmap.h"
+
+#include <gemmi/third_party/pocketfft_hdronly.h>
+
+
+namespace clipper {
+
+
+/* The hermitian data is nu*nv*(nw/2+1) complex, the real data has
+   rows padded to the same byte length, so both strides are common to
+   the two spaces except along the last axis. pocketfft copies each
+   line to a buffer before transforming it, so the in-place transforms
+   are safe. */
+
+/*! \param grid The real space grid.
+  \param data The hermitian data, transformed in place.
+  \param nthreads The number of threads. */
+void FFTengine_pocketfft::fft_h_to_x( const Grid& grid, std::complex<ffttype>* data, const FFTtype&, const int& nthreads ) const
+{
+  size_t nu = grid.nu(), nv = grid.nv(), nw = grid.nw(), nh = nw/2+1;
+  std::ptrdiff_t sc = sizeof(std::complex<ffttype>), sr = sizeof(ffttype);
+  size_t nthd = ( nthreads > 1 ) ? nthreads : 1;
+  pocketfft::shape_t shape_c{ nu, nv, nh };
+  pocketfft::shape_t shape_r{ nu, nv, nw };
+  pocketfft::stride_t stride_c{ sc*std::ptrdiff_t(nv*nh), sc*std::ptrdiff_t(nh), sc };
+  pocketfft::stride_t stride_r{ sc*std::ptrdiff_t(nv*nh), sc*std::ptrdiff_t(nh), sr };
+  pocketfft::c2c<ffttype>( shape_c, stride_c, stride_c, {0, 1},
+			   pocketfft::BACKWARD, data, data, 1.0f, nthd );
+  pocketfft::c2r<ffttype>( shape_r, stride_c, stride_r, 2,
+			   pocketfft::BACKWARD, data, (ffttype*)data, 1.0f, nthd );
+}
+
+
+/*! \param grid The real space grid.
+  \param data The real data, transformed in place.
+  \param nthreads The number of threads. */
+void FFTengine_pocketfft::fft_x_to_h( const Grid& grid, ffttype* data, const FFTtype&, const int& nthreads ) const
+{
+  size_t nu = grid.nu(), nv = grid.nv(), nw = grid.nw(), nh = nw/2+1;
+  std::ptrdiff_t sc = sizeof(std::complex<ffttype>), sr = sizeof(ffttype);
+  size_t nthd = ( nthreads > 1 ) ? nthreads : 1;
+  pocketfft::shape_t shape_c{ nu, nv, nh };
+  pocketfft::shape_t shape_r{ nu, nv, nw };
+  pocketfft::stride_t stride_c{ sc*std::ptrdiff_t(nv*nh), sc*std::ptrdiff_t(nh), sc };
+  pocketfft::stride_t stride_r{ sc*std::ptrdiff_t(nv*nh), sc*std::ptrdiff_t(nh), sr };
+  std::complex<ffttype>* data_c = (std::complex<ffttype>*)data;
+  pocketfft::r2c<ffttype>( shape_r, stride_r, stride_c, 2,
+			   pocketfft::FORWARD, data, data_c, 1.0f, nthd );
+  pocketfft::c2c<ffttype>( shape_c, stride_c, stride_c, {0, 1},
+			   pocketfft::FORWARD, data_c, data_c, 1.0f, nthd );
+}
+
+
+} // namespace clipper
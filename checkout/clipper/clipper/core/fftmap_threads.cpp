@@ -0,0 +1,167 @@
+/* fftmap_threads.cpp: FFT engine selection and threaded transforms for P1 fft map */
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+
+#include "fftmap.h"
+
+
+namespace clipper {
+
+
+std::atomic<int> FFTmap_base::default_threads_( 1 );
+#ifndef CLIPPER_DISABLE_FFTW2
+std::atomic<FFTmap_base::FFTbackend> FFTmap_base::default_backend_( FFTmap_base::FFTW2 );
+#else
+std::atomic<FFTmap_base::FFTbackend> FFTmap_base::default_backend_( FFTmap_base::PocketFFT );
+#endif
+
+
+/*! The engines are stateless apart from the shared plan cache, so a
+  single instance of each serves every thread. In a build without
+  FFTW 2 the pocketfft engine is returned for either library.
+  \param backend The transform library.
+  \return The engine for that library. */
+const FFTengine& FFTmap_base::engine( const FFTbackend& backend )
+{
+  static const FFTengine_pocketfft engine_pocketfft;
+  if ( backend == PocketFFT ) return engine_pocketfft;
+#ifndef CLIPPER_DISABLE_FFTW2
+  static const FFTengine_fftw2 engine_fftw2;
+  return engine_fftw2;
+#else
+  return engine_pocketfft;
+#endif
+}
+
+
+/*! All plans held in the FFTW 2 plan cache are destroyed. This must
+  not be called while any cached-plan transform is running. */
+void FFTmap_base::clear_plans()
+{
+#ifndef CLIPPER_DISABLE_FFTW2
+  FFTengine_fftw2::destroy_plans();
+#endif
+}
+
+
+/*! The data is transformed in place as by fft_h_to_x( scale ), but
+  the transform is performed by the engine for default_backend() and
+  is shared between the given number of threads.
+  \param scale The scale factor by which to multiply the results.
+  \param nthreads The number of threads, or 0 for default_threads(). */
+void FFTmap_p1::fft_h_to_x( const ftype& scale, const int& nthreads )
+{
+  if ( mode == REAL ) return;
+  // scale and conjugate
+  int n = grid_reci_.size();
+  ffttype s = ffttype( scale );
+  for ( int i = 0; i < n; i++ ) data_c[i] = s * std::conj( data_c[i] );
+  // fft
+  int nthd = ( nthreads > 0 ) ? nthreads : default_threads();
+  engine( default_backend() ).fft_h_to_x( grid_sam_, data_c, type_, nthd );
+  mode = REAL;
+}
+
+
+/*! The data is transformed in place as by fft_x_to_h( scale ), but
+  the transform is performed by the engine for default_backend() and
+  is shared between the given number of threads.
+  \param scale The scale factor by which to multiply the results.
+  \param nthreads The number of threads, or 0 for default_threads(). */
+void FFTmap_p1::fft_x_to_h( const ftype& scale, const int& nthreads )
+{
+  if ( mode == RECI ) return;
+  // fft
+  int nthd = ( nthreads > 0 ) ? nthreads : default_threads();
+  engine( default_backend() ).fft_x_to_h( grid_sam_, data_r, type_, nthd );
+  // scale and conjugate
+  int n = grid_reci_.size();
+  ffttype s = ffttype( scale ) / grid_sam_.size();
+  for ( int i = 0; i < n; i++ ) data_c[i] = s * std::conj( data_c[i] );
+  mode = RECI;
+}
+
+
+/*! \param nthreads The number of threads, or 0 for default_threads(). */
+void FFTmap::fft_h_to_x( const int& nthreads )
+{
+  if ( mode == RECI ) FFTmap_p1::fft_h_to_x( 1.0/cell_.volume(), nthreads );
+}
+
+
+/*! \param nthreads The number of threads, or 0 for default_threads(). */
+void FFTmap::fft_x_to_h( const int& nthreads )
+{
+  if ( mode == REAL ) FFTmap_p1::fft_x_to_h( cell_.volume(), nthreads );
+}
+
+
+#ifdef CLIPPER_DISABLE_FFTW2
+/* Without FFTW 2 the single-threaded transforms are also performed by
+   the engine for default_backend(). In this configuration these
+   replace the FFTW 2 definitions in fftmap.cpp. */
+
+/*! \param scale The scale factor by which to multiply the results. */
+void FFTmap_p1::fft_h_to_x( const ftype& scale )
+{
+  fft_h_to_x( scale, 1 );
+}
+
+/*! \param scale The scale factor by which to multiply the results. */
+void FFTmap_p1::fft_x_to_h( const ftype& scale )
+{
+  fft_x_to_h( scale, 1 );
+}
+
+void FFTmap::fft_h_to_x()
+{
+  fft_h_to_x( 1 );
+}
+
+void FFTmap::fft_x_to_h()
+{
+  fft_x_to_h( 1 );
+}
+#endif
+
+
+} // namespace clipper
@@ -62,6 +62,8 @@ namespace clipper
       const Spgr_descr& spgr_descr() const { return spgr_descr_; }
       const Cell_descr& cell_descr() const { return cell_descr_; }
       const HKL_sampling& hkl_sampling() const { return hkl_sampling_; }
+      //! hash code for sharded caching (cell matching is approximate)
+      unsigned int hash() const { return spgr_descr_.hash(); }
     private:
       Spgr_descr spgr_descr_;
       Cell_descr cell_descr_;
@@ -309,6 +311,29 @@ namespace clipper
     //! Binary computation: fill this data list by computation from another
     template<class S1, class S2, class C> void compute( const HKL_data<S1>& src1, const HKL_data<S2>& src2, const C& op )
       { for (HKL_info::HKL_reference_index ih=parent_hkl_info->first(); !ih.last(); ih.next()) list[ih.index()] = op( ih, src1[ih], src2[ih] ); }
+    //! Basic computation, split over threads
+    template<class C> void compute( const C& op, const Execution_policy& exec )
+      { parallel_ranges( parent_hkl_info->num_reflections(), exec.num_threads(), Compute0<C>( *this, op ) ); }
+    //! Unary computation, split over threads
+    template<class S, class C> void compute( const HKL_data<S>& src, const C& op, const Execution_policy& exec )
+      { parallel_ranges( parent_hkl_info->num_reflections(), exec.num_threads(), Compute1<S,C>( *this, src, op ) ); }
+    //! Binary computation, split over threads
+    template<class S1, class S2, class C> void compute( const HKL_data<S1>& src1, const HKL_data<S2>& src2, const C& op, const Execution_policy& exec )
+      { parallel_ranges( parent_hkl_info->num_reflections(), exec.num_threads(), Compute2<S1,S2,C>( *this, src1, src2, op ) ); }
+
+    //! Reduction: sum of op( ih, data ) over all reflections
+    /*! R is the result type; it must support += and be initialised
+      from zero. With multiple threads, partial sums from contiguous
+      ranges are added in order, so the result is reproducible for a
+      given number of threads. */
+    template<class R, class C> R reduce( const C& op, const R& zero, const Execution_policy& exec = Execution_policy() ) const
+      {
+	std::vector<R> sums( exec.num_threads() > 1 ? exec.num_threads() : 1, zero );
+	parallel_ranges( parent_hkl_info->num_reflections(), exec.num_threads(), Reduce<R,C>( *this, op, sums ) );
+	R sum = zero;
+	for ( int i = 0; i < int(sums.size()); i++ ) sum += sums[i];
+	return sum;
+      }
 
     // inherited functions lists for documentation purposes
     //-- const HKL_info& base_hkl_info() const;
@@ -330,6 +355,51 @@ namespace clipper
   protected:
     // members
     std::vector<T> list;
+
+  private:
+    // range functors for the threaded computations
+    template<class C> class Compute0 {
+    public:
+      Compute0( HKL_data<T>& d, const C& op ) : d_(&d), op_(&op) {}
+      void operator() ( const int&, const int& begin, const int& end ) const {
+	HKL_info::HKL_reference_index ih( d_->base_hkl_info(), begin );
+	for ( ; ih.index() < end; ih.next() ) d_->list[ih.index()] = (*op_)( ih );
+      }
+    private:
+      HKL_data<T>* d_; const C* op_;
+    };
+    template<class S, class C> class Compute1 {
+    public:
+      Compute1( HKL_data<T>& d, const HKL_data<S>& s, const C& op ) : d_(&d), s_(&s), op_(&op) {}
+      void operator() ( const int&, const int& begin, const int& end ) const {
+	HKL_info::HKL_reference_index ih( d_->base_hkl_info(), begin );
+	for ( ; ih.index() < end; ih.next() ) d_->list[ih.index()] = (*op_)( ih, (*s_)[ih] );
+      }
+    private:
+      HKL_data<T>* d_; const HKL_data<S>* s_; const C* op_;
+    };
+    template<class S1, class S2, class C> class Compute2 {
+    public:
+      Compute2( HKL_data<T>& d, const HKL_data<S1>& s1, const HKL_data<S2>& s2, const C& op ) : d_(&d), s1_(&s1), s2_(&s2), op_(&op) {}
+      void operator() ( const int&, const int& begin, const int& end ) const {
+	HKL_info::HKL_reference_index ih( d_->base_hkl_info(), begin );
+	for ( ; ih.index() < end; ih.next() ) d_->list[ih.index()] = (*op_)( ih, (*s1_)[ih], (*s2_)[ih] );
+      }
+    private:
+      HKL_data<T>* d_; const HKL_data<S1>* s1_; const HKL_data<S2>* s2_; const C* op_;
+    };
+    template<class R, class C> class Reduce {
+    public:
+      Reduce( const HKL_data<T>& d, const C& op, std::vector<R>& sums ) : d_(&d), op_(&op), sums_(&sums) {}
+      void operator() ( const int& chunk, const int& begin, const int& end ) const {
+	R sum = (*sums_)[chunk];  // local accumulator avoids false sharing
+	HKL_info::HKL_reference_index ih( d_->base_hkl_info(), begin );
+	for ( ; ih.index() < end; ih.next() ) sum += (*op_)( ih, d_->list[ih.index()] );
+	(*sums_)[chunk] = sum;
+      }
+    private:
+      const HKL_data<T>* d_; const C* op_; std::vector<R>* sums_;
+    };
   };
 
 
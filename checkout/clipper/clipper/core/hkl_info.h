@@ -99,6 +99,12 @@ namespace clipper
      \param rfl The HKL. \return The index, or -1 if it does not exist. */
     inline int index_of( const HKL& rfl ) const
       { return lookup.index_of( rfl ); }
+    //! reflection indices from a list of hkl
+    /*! This does not check symmetry equivalents (see find_sym).
+     \param rfl The HKLs. \param index Returns the indices, or -1 for
+     HKLs which do not exist. */
+    inline void index_of( const std::vector<HKL>& rfl, std::vector<int>& index ) const
+      { index.resize( rfl.size() ); for ( size_t i = 0; i < rfl.size(); i++ ) index[i] = lookup.index_of( rfl[i] ); }
 
     //! get reflection resolution using lookup
     inline const ftype32& invresolsq( const int& index ) const
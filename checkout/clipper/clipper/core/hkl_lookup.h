@@ -78,6 +78,70 @@ namespace clipper
   };
 
 
+  //! Flat reflection lookup object
+  /*! This version stores the reflection indices in a single flat
+    table. If the HKLs fill a reasonable fraction of their bounding
+    box, a dense 3D offset table is used, otherwise an open-addressing
+    hash table on packed Miller indices. A lookup touches one or two
+    cache lines instead of the three dependent vectors of HKL_lookup. */
+
+  class HKL_lookup_flat {
+   public:
+    //! null constructor: an empty table
+    HKL_lookup_flat() { init( std::vector<HKL>() ); }
+    //! initialise: make a reflection index for a list of HKLs
+    void init(const std::vector<HKL>& hkl);
+
+    //! lookup function
+    inline int index_of(const HKL& rfl) const {
+      if ( !dense.empty() ) {
+        const unsigned int h = rfl.h() - min_[0];
+        const unsigned int k = rfl.k() - min_[1];
+        const unsigned int l = rfl.l() - min_[2];
+        if ( h >= dim_[0] || k >= dim_[1] || l >= dim_[2] ) return -1;
+        return dense[ ( h*dim_[1] + k )*dim_[2] + l ];
+      }
+      if ( table.empty() ) return -1;
+      const unsigned long long key = pack( rfl );
+      for ( size_t i = slot( key ); ; i = ( i + 1 ) & mask ) {
+        const Entry& e = table[i];
+        if ( e.index < 0 ) return -1;
+        if ( e.key == key ) return e.index;
+      }
+    }
+    //! batch lookup: index[i] = index_of( rfl[i] ), for i < n
+    void index_of(const HKL* rfl, int* index, const int& n) const
+      { for ( int i = 0; i < n; i++ ) index[i] = index_of( rfl[i] ); }
+    //! batch lookup: fill index with the indices of the given HKLs
+    void index_of(const std::vector<HKL>& rfl, std::vector<int>& index) const
+      { index.resize( rfl.size() ); if ( !rfl.empty() ) index_of( &rfl[0], &index[0], rfl.size() ); }
+
+    //! true if the dense table is used
+    bool is_dense() const { return !dense.empty(); }
+
+    void debug();
+
+  private:
+    struct Entry { unsigned long long key; int index; };
+    //! pack H,K,L into 21 bits each
+    static unsigned long long pack(const HKL& rfl) {
+      return ( ( (unsigned long long)( rfl.h() & 0x1fffff ) << 42 ) |
+               ( (unsigned long long)( rfl.k() & 0x1fffff ) << 21 ) |
+               (unsigned long long)( rfl.l() & 0x1fffff ) );
+    }
+    //! initial slot for a key (Fibonacci hashing)
+    size_t slot(const unsigned long long& key) const
+      { return size_t( ( key * 0x9e3779b97f4a7c15ULL ) >> shift ); }
+
+    int min_[3];                   //!< minimum H,K,L (dense table)
+    unsigned int dim_[3];          //!< extent of H,K,L (dense table)
+    std::vector<int> dense;        //!< dense table
+    std::vector<Entry> table;      //!< hash table
+    size_t mask;                   //!< table size - 1
+    int shift;                     //!< 64 - log2( table size )
+  };
+
+
 } // namespace clipper
 
 #endif
@@ -0,0 +1,117 @@
+/* hkl_lookup_flat.cpp: class file for flat reflection lookup */
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+#include "hkl_lookup.h"
+
+#include <iostream>
+
+
+namespace clipper {
+
+
+void HKL_lookup_flat::init( const std::vector<HKL>& hkl )
+{
+  dense.clear();
+  table.clear();
+  for ( int j = 0; j < 3; j++ ) { min_[j] = 0; dim_[j] = 0; }
+  mask = 0;
+  shift = 64;
+  if ( hkl.empty() ) return;
+
+  // bounding box of the reflections
+  int max_[3];
+  for ( int j = 0; j < 3; j++ ) min_[j] = max_[j] = hkl[0][j];
+  for ( int i = 1; i < int(hkl.size()); i++ )
+    for ( int j = 0; j < 3; j++ ) {
+      min_[j] = Util::min( min_[j], hkl[i][j] );
+      max_[j] = Util::max( max_[j], hkl[i][j] );
+    }
+  double vol = 1.0;
+  for ( int j = 0; j < 3; j++ ) {
+    dim_[j] = max_[j] - min_[j] + 1;
+    vol *= double( dim_[j] );
+  }
+
+  // dense table if the box is at least a quarter full
+  if ( vol <= 4.0 * double( hkl.size() ) + 1024.0 ) {
+    dense.assign( size_t( vol ), -1 );
+    for ( int i = int(hkl.size()) - 1; i >= 0; i-- ) {
+      const unsigned int h = hkl[i].h() - min_[0];
+      const unsigned int k = hkl[i].k() - min_[1];
+      const unsigned int l = hkl[i].l() - min_[2];
+      dense[ ( h*dim_[1] + k )*dim_[2] + l ] = i;  // first occurrence wins
+    }
+    return;
+  }
+
+  // otherwise hash table, at most half full
+  int bits = 4;
+  while ( ( size_t(1) << bits ) < 2 * hkl.size() ) bits++;
+  shift = 64 - bits;
+  mask = ( size_t(1) << bits ) - 1;
+  Entry empty = { 0, -1 };
+  table.assign( mask + 1, empty );
+  for ( int i = 0; i < int(hkl.size()); i++ ) {
+    const unsigned long long key = pack( hkl[i] );
+    size_t s = slot( key );
+    while ( table[s].index >= 0 && table[s].key != key ) s = ( s + 1 ) & mask;
+    if ( table[s].index < 0 ) {
+      table[s].key = key;
+      table[s].index = i;
+    }
+  }
+}
+
+
+void HKL_lookup_flat::debug()
+{
+  if ( is_dense() ) {
+    std::cout << "Dense table " << dim_[0] << "x" << dim_[1] << "x" << dim_[2] << " from " << min_[0] << "," << min_[1] << "," << min_[2] << "\n";
+  } else {
+    int used = 0;
+    for ( size_t i = 0; i < table.size(); i++ ) if ( table[i].index >= 0 ) used++;
+    std::cout << "Hash table " << used << "/" << table.size() << " slots used\n";
+  }
+}
+
+
+} // namespace clipper
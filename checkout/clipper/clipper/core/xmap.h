@@ -64,6 +64,8 @@ namespace clipper
 	spgr_descr_(spgr_descr), grid_sampling_(grid) {}
       const Spgr_descr& spgr_descr() const { return spgr_descr_; }
       const Grid_sampling& grid_sampling() const { return grid_sampling_; }
+      //! hash code for sharded caching
+      unsigned int hash() const { return spgr_descr_.hash() ^ ( ( grid_sampling_.nu()*73856093u ) ^ ( grid_sampling_.nv()*19349663u ) ^ ( grid_sampling_.nw()*83492791u ) ); }
     private:
       Spgr_descr spgr_descr_;
       Grid_sampling grid_sampling_;
@@ -398,11 +400,17 @@ namespace clipper
     template<class I> void interp_grad( const Coord_map& pos, T& val, Grad_map<T>& grad ) const;
     //! get map value and curv for map coord using supplied interpolator
     template<class I> void interp_curv( const Coord_map& pos, T& val, Grad_map<T>& grad, Curv_map<T>& curv ) const;
+    //! get map values for a list of fractional coords using supplied interpolator
+    template<class I> void interp( const std::vector<Coord_frac>& pos, std::vector<T>& val ) const;
 
     //! FFT from reflection list to map
     template<class H> void fft_from( const H& fphidata, const FFTtype type = Default );
     //! FFT from map to reflection list
     template<class H> void fft_to  ( H& fphidata, const FFTtype type = Default ) const;
+    //! FFT from reflection list to map, reusing a workspace
+    template<class H> void fft_from( const H& fphidata, FFTmap_workspace& workspace );
+    //! FFT from map to reflection list, reusing a workspace
+    template<class H> void fft_to  ( H& fphidata, FFTmap_workspace& workspace ) const;
 
     // inherited functions listed for documentation purposes
     //-- const Cell& cell() const;
@@ -424,6 +432,68 @@ namespace clipper
     const Xmap<T>& operator -=( const Xmap<T>& other );
 
   private:
+    //! copy reflections into a P1 map, expanding by symmetry
+    template<class H> void fft_copy_hkl( const H& fphidata, FFTmap_p1& fftmap ) const;
+    //! copy the map into a P1 map, expanding by symmetry
+    void fft_copy_map( FFTmap_p1& fftmap ) const;
+
+    std::vector<T> list;
+  };
+
+
+  //! Xmap_box<T>: P1 copy of a region of a crystallographic map
+  /*! The box holds the map values for a rectangular range of grid
+    coordinates, expanded by symmetry and lattice translations, in a
+    single contiguous array. Interpolation in the box needs no
+    symmetry lookups, so when many interpolations are made in a region
+    of interest (e.g. when scoring a ligand at many positions) it is
+    much faster than interpolating in the Xmap itself.
+
+    Points which are outside the box are interpolated in the original
+    map, which must therefore outlive the box. The box is not updated
+    if the map changes.
+    \code
+    Xmap_box<float> box( xmap, coords, Interp_cubic::order() );
+    box.interp<Interp_cubic>( coords, values );
+    \endcode
+  */
+  template<class T> class Xmap_box
+  {
+  public:
+    //! Null constructor, for later initialisation
+    Xmap_box() : xmap_(NULL) {}
+    //! constructor: from map and grid range
+    Xmap_box( const Xmap<T>& xmap, const Grid_range& range ) { init( xmap, range ); }
+    //! constructor: from map and the coords to be interpolated
+    Xmap_box( const Xmap<T>& xmap, const std::vector<Coord_frac>& pos, const int& order = 3 ) { init( xmap, pos, order ); }
+    //! initialiser: from map and grid range
+    void init( const Xmap<T>& xmap, const Grid_range& range );
+    //! initialiser: from map and the coords to be interpolated
+    void init( const Xmap<T>& xmap, const std::vector<Coord_frac>& pos, const int& order = 3 );
+
+    //! get the range of grid coordinates covered by the box
+    const Grid_range& grid_range() const { return range_; }
+    //! test if an interpolant of the given order can be used in the box
+    bool in_box( const Coord_map& pos, const int& order ) const;
+    //! get a density value for a grid coordinate in the box
+    const T& get_data( const Coord_grid& pos ) const
+      { return list[ range_.index( pos ) ]; }
+
+    //! get map value for map coord using supplied interpolator
+    template<class I> T interp( const Coord_map& pos ) const;
+    //! get map value for fractional coord using supplied interpolator
+    template<class I> T interp( const Coord_frac& pos ) const
+      { return interp<I>( pos.coord_map( grid_sam_ ) ); }
+    //! get map values for a list of fractional coords using supplied interpolator
+    template<class I> void interp( const std::vector<Coord_frac>& pos, std::vector<T>& val ) const;
+
+    //! return the grid range needed to interpolate at the given coords
+    static Grid_range bounding_range( const Grid_sampling& grid, const std::vector<Coord_frac>& pos, const int& order );
+
+  private:
+    const Xmap<T>* xmap_;     //!< source map, for points outside the box
+    Grid_sampling grid_sam_;  //!< grid sampling of the source map
+    Grid_range range_;        //!< grid coordinates covered by the box
     std::vector<T> list;
   };
 
@@ -597,13 +667,182 @@ namespace clipper
     { I::interp_curv( *this, pos, val, grad, curv ); }
 
 
+  /*! The values of the map at a list of non-grid fractional
+    coordinates are calculated using the supplied interpolator
+    template. If the coordinates are clustered in a region which is
+    small compared with the number of interpolations, the region is
+    first copied into an Xmap_box, so that the symmetry lookups are
+    done once per grid point rather than for every interpolation.
+    \param pos The fractional coords at which the density is to be calcuated.
+    \param val Returns the values of the density at those points. */
+  template<class T> template<class I> void Xmap<T>::interp( const std::vector<Coord_frac>& pos, std::vector<T>& val ) const
+  {
+    val.resize( pos.size() );
+    if ( pos.empty() ) return;
+    const Grid_range range = Xmap_box<T>::bounding_range( grid_sam_, pos, I::order() );
+    const int npts = ( I::order() + 1 ) * ( I::order() + 1 ) * ( I::order() + 1 );
+    if ( double( range.size() ) <= double( npts ) * double( pos.size() ) &&
+	 range.size() <= grid_sam_.size() ) {
+      Xmap_box<T> box( *this, range );
+      box.template interp<I>( pos, val );
+    } else {
+      for ( int i = 0; i < int(pos.size()); i++ )
+	I::interp( *this, pos[i].coord_map( grid_sam_ ), val[i] );
+    }
+  }
+
+
+  /*! The box is filled from the map by iterating along the fast (w)
+    axis with a Map_reference_coord, so each symmetry lookup is
+    shared by a row of grid points.
+    \param xmap The map from which the box is copied.
+    \param range The grid coordinates to be included in the box. */
+  template<class T> void Xmap_box<T>::init( const Xmap<T>& xmap, const Grid_range& range )
+  {
+    xmap_ = &xmap;
+    grid_sam_ = xmap.grid_sampling();
+    range_ = range;
+    list.resize( range_.size() );
+    typename Xmap<T>::Map_reference_coord ix( xmap );
+    int i = 0;
+    for ( int u = range_.min().u(); u <= range_.max().u(); u++ )
+      for ( int v = range_.min().v(); v <= range_.max().v(); v++ ) {
+	ix.set_coord( Coord_grid( u, v, range_.min().w() ) );
+	for ( int w = range_.min().w(); w <= range_.max().w(); w++ ) {
+	  list[i++] = xmap[ix];
+	  ix.next_w();
+	}
+      }
+  }
+
+  /*! The box is made just large enough to interpolate at all of the
+    given coordinates using an interpolant of the given order.
+    \param xmap The map from which the box is copied.
+    \param pos The fractional coords at which the density will be calcuated.
+    \param order The order of the interpolant, e.g. Interp_cubic::order(). */
+  template<class T> void Xmap_box<T>::init( const Xmap<T>& xmap, const std::vector<Coord_frac>& pos, const int& order )
+  {
+    init( xmap, bounding_range( xmap.grid_sampling(), pos, order ) );
+  }
+
+  /*! \param pos The map coord.
+    \param order The order of the interpolant.
+    \return true if all the grid points required are in the box. */
+  template<class T> bool Xmap_box<T>::in_box( const Coord_map& pos, const int& order ) const
+  {
+    Coord_grid c( ( order == 0 ) ? pos.coord_grid() : pos.floor() );
+    c.u() -= order/2; c.v() -= order/2; c.w() -= order/2;
+    if ( !range_.in_grid( c ) ) return false;
+    c.u() += order; c.v() += order; c.w() += order;
+    return range_.in_grid( c );
+  }
+
+  /*! The interpolant is evaluated directly on the contiguous box
+    array, using the same coefficients as the Interp_nearest,
+    Interp_linear and Interp_cubic classes. Points outside the box,
+    and other interpolators, are passed on to the source map.
+    \param pos The map coord at which the density is to be calcuated.
+    \return The value of the density at that point. */
+  template<class T> template<class I> T Xmap_box<T>::interp( const Coord_map& pos ) const
+  {
+    const int order = I::order();
+    if ( ( order != 0 && order != 1 && order != 3 ) || !in_box( pos, order ) ) {
+      T val;
+      I::interp( *xmap_, pos, val );
+      return val;
+    }
+    if ( order == 0 ) return list[ range_.index( pos.coord_grid() ) ];
+    const int su = range_.nv() * range_.nw();
+    const int sv = range_.nw();
+    ftype u0 = floor( pos.u() );
+    ftype v0 = floor( pos.v() );
+    ftype w0 = floor( pos.w() );
+    T cu1( pos.u() - u0 );
+    T cv1( pos.v() - v0 );
+    T cw1( pos.w() - w0 );
+    T cu0( 1.0 - cu1 );
+    T cv0( 1.0 - cv1 );
+    T cw0( 1.0 - cw1 );
+    if ( order == 1 ) {
+      const T* p = &list[ range_.index( Coord_grid( int(u0), int(v0), int(w0) ) ) ];
+      T r00 = cw0 * p[0]     + cw1 * p[1];
+      T r01 = cw0 * p[sv]    + cw1 * p[sv+1];
+      T r10 = cw0 * p[su]    + cw1 * p[su+1];
+      T r11 = cw0 * p[su+sv] + cw1 * p[su+sv+1];
+      return ( cu0*( cv0*r00 + cv1*r01 ) + cu1*( cv0*r10 + cv1*r11 ) );
+    }
+    T cu[4], cv[4], cw[4];
+    cu[0] = -0.5*cu1*cu0*cu0; // cubic spline coeffs: u
+    cu[1] = cu0*( -1.5*cu1*cu1 + cu1 + 1.0 );
+    cu[2] = cu1*( -1.5*cu0*cu0 + cu0 + 1.0 );
+    cu[3] = -0.5*cu1*cu1*cu0;
+    cv[0] = -0.5*cv1*cv0*cv0; // cubic spline coeffs: v
+    cv[1] = cv0*( -1.5*cv1*cv1 + cv1 + 1.0 );
+    cv[2] = cv1*( -1.5*cv0*cv0 + cv0 + 1.0 );
+    cv[3] = -0.5*cv1*cv1*cv0;
+    cw[0] = -0.5*cw1*cw0*cw0; // cubic spline coeffs: w
+    cw[1] = cw0*( -1.5*cw1*cw1 + cw1 + 1.0 );
+    cw[2] = cw1*( -1.5*cw0*cw0 + cw0 + 1.0 );
+    cw[3] = -0.5*cw1*cw1*cw0;
+    const T* pu = &list[ range_.index( Coord_grid( int(u0)-1, int(v0)-1, int(w0)-1 ) ) ];
+    T su_ = 0.0;
+    for ( int j = 0; j < 4; j++, pu += su ) {
+      const T* pv = pu;
+      T sv_ = 0.0;
+      for ( int i = 0; i < 4; i++, pv += sv )
+	sv_ += cv[i] * ( cw[0]*pv[0] + cw[1]*pv[1] + cw[2]*pv[2] + cw[3]*pv[3] );
+      su_ += cu[j] * sv_;
+    }
+    return su_;
+  }
+
+  /*! \param pos The fractional coords at which the density is to be calcuated.
+    \param val Returns the values of the density at those points. */
+  template<class T> template<class I> void Xmap_box<T>::interp( const std::vector<Coord_frac>& pos, std::vector<T>& val ) const
+  {
+    val.resize( pos.size() );
+    for ( int i = 0; i < int(pos.size()); i++ )
+      val[i] = interp<I>( pos[i].coord_map( grid_sam_ ) );
+  }
+
+  /*! \param grid The grid sampling of the map.
+    \param pos The fractional coords at which the density will be calcuated.
+    \param order The order of the interpolant.
+    \return The smallest grid range which contains all the required points. */
+  template<class T> Grid_range Xmap_box<T>::bounding_range( const Grid_sampling& grid, const std::vector<Coord_frac>& pos, const int& order )
+  {
+    if ( pos.empty() ) return Grid_range( Coord_grid(0,0,0), Coord_grid(0,0,0) );
+    Coord_grid c0 = pos[0].coord_map( grid ).floor();
+    Coord_grid c1 = c0;
+    for ( int i = 1; i < int(pos.size()); i++ ) {
+      const Coord_grid c = pos[i].coord_map( grid ).floor();
+      for ( int j = 0; j < 3; j++ ) {
+	c0[j] = Util::min( c0[j], c[j] );
+	c1[j] = Util::max( c1[j], c[j] );
+      }
+    }
+    // nearest neighbour rounds up as well as down
+    const int lo = order/2;
+    const int hi = Util::max( order, 1 ) - order/2;
+    return Grid_range( Coord_grid( c0.u()-lo, c0.v()-lo, c0.w()-lo ),
+		       Coord_grid( c1.u()+hi, c1.v()+hi, c1.w()+hi ) );
+  }
+
+
   /*! An FFT is calculated using the provided reflection list of
     F_phi, and used to fill this map. The reflection list is unchanged.
+    The normal transform uses cached plans and
+    FFTmap_base::default_threads() threads. A sparse transform is only
+    made when FFTW 2 is the default backend; otherwise the normal
+    transform is used.
     \param fphidata The reflection data list to use
   */
   template<class T> template<class H> void Xmap<T>::fft_from( const H& fphidata, const FFTtype type )
   {
-    if ( type == Sparse || ( type == Default && default_type() == Sparse ) ) {
+#ifndef CLIPPER_DISABLE_FFTW2
+    // the sparse maps use FFTW 2 directly, so only use them with FFTW 2
+    if ( FFTmap_base::default_backend() == FFTmap_base::FFTW2 &&
+	 ( type == Sparse || ( type == Default && default_type() == Sparse ) ) ) {
       // make a sparse fftmap
       FFTmap_sparse_p1_hx fftmap( grid_sampling() );
       // copy from reflection data
@@ -632,29 +871,15 @@ namespace clipper
       // fill map ASU
       for ( Map_reference_index ix = first(); !ix.last(); ix.next() )
 	(*this)[ix] = fftmap.real_data( ix.coord() );
-    } else {
+    } else
+#endif
+    {
       // make a normal fftmap
       FFTmap_p1 fftmap( grid_sampling() );
       // copy from reflection data
-      typename H::HKL_reference_index ih;
-      ffttype f, phi0, phi1;
-      int sym;
-      for ( ih = fphidata.first_data(); !ih.last(); fphidata.next_data( ih ) ) {
-	f = fphidata[ih].f();
-	if ( f != 0.0 ) {
-	  phi0 = fphidata[ih].phi();
-	  const HKL& hkl = ih.hkl();
-	  fftmap.set_hkl( hkl,
-			  std::complex<ffttype>( f*cos(phi0), f*sin(phi0) ) );
-	  for ( sym = 1; sym < spacegroup_.num_primops(); sym++ ) {
-	    phi1 = phi0 + hkl.sym_phase_shift( spacegroup_.symop(sym) );
-	    fftmap.set_hkl( hkl.transform( isymop[sym] ),
-			    std::complex<ffttype>( f*cos(phi1), f*sin(phi1) ) );
-	  }
-	}
-      }
-      // do fft
-      fftmap.fft_h_to_x(1.0/cell().volume());
+      fft_copy_hkl( fphidata, fftmap );
+      // do fft, using cached plans and default_threads()
+      fftmap.fft_h_to_x( 1.0/cell().volume(), 0 );
       // fill map ASU
       for ( Map_reference_index ix = first(); !ix.last(); ix.next() )
 	(*this)[ix] = fftmap.real_data( ix.coord() );
@@ -668,11 +893,19 @@ namespace clipper
     Arguably this should be part of hkl_data<F_phi<T>>. But that
     requires writing a specialisation of hkl_data for F_phi. This is
     simpler and imposes less demands on the compiler.
+
+    The normal transform uses cached plans and
+    FFTmap_base::default_threads() threads. A sparse transform is only
+    made when FFTW 2 is the default backend; otherwise the normal
+    transform is used.
     \param fphidata The reflection data list to set.
   */
   template<class T> template<class H> void Xmap<T>::fft_to  ( H& fphidata, const FFTtype type ) const
   {
-    if ( type == Sparse || ( type == Default && default_type() == Sparse ) ) {
+#ifndef CLIPPER_DISABLE_FFTW2
+    // the sparse maps use FFTW 2 directly, so only use them with FFTW 2
+    if ( FFTmap_base::default_backend() == FFTmap_base::FFTW2 &&
+	 ( type == Sparse || ( type == Default && default_type() == Sparse ) ) ) {
       // make a sparse fftmap
       FFTmap_sparse_p1_xh fftmap( grid_sampling() );
       // copy from map data
@@ -699,23 +932,15 @@ namespace clipper
 	fphidata[ih].f() = std::abs(c);
 	fphidata[ih].phi() = std::arg(c);
       }
-    } else {
+    } else
+#endif
+    {
       // make a normal fftmap
       FFTmap_p1 fftmap( grid_sampling() );
       // copy from map data
-      ffttype f;
-      int sym;
-      for ( Map_reference_index ix = first(); !ix.last(); ix.next() ) {
-	f = (*this)[ix];
-	if ( f != 0.0 ) {
-	  fftmap.real_data( ix.coord() ) = f;
-	  for ( sym = 1; sym < cacheref.data().nsym; sym++ )
-	    fftmap.real_data(
-              ix.coord().transform( isymop[sym] ).unit( grid_sam_ ) ) = f;
-	}
-      }
-      // do fft
-      fftmap.fft_x_to_h(cell().volume());
+      fft_copy_map( fftmap );
+      // do fft, using cached plans and default_threads()
+      fftmap.fft_x_to_h( cell().volume(), 0 );
       // fill data ASU
       typename H::HKL_reference_index ih;
       for ( ih = fphidata.first(); !ih.last(); ih.next() ) {
@@ -727,6 +952,80 @@ namespace clipper
   }
 
 
+  /*! As fft_from( fphidata ), but the P1 map held by the workspace is
+    reused, so that repeated transforms on the same grid do not
+    allocate or plan, and the transform uses the workspace's threads.
+    \param fphidata The reflection data list to use
+    \param workspace The workspace to use for the transform.
+  */
+  template<class T> template<class H> void Xmap<T>::fft_from( const H& fphidata, FFTmap_workspace& workspace )
+  {
+    FFTmap_p1& fftmap = workspace.fftmap( grid_sampling() );
+    fft_copy_hkl( fphidata, fftmap );
+    fftmap.fft_h_to_x( 1.0/cell().volume(), workspace.num_threads() );
+    for ( Map_reference_index ix = first(); !ix.last(); ix.next() )
+      (*this)[ix] = fftmap.real_data( ix.coord() );
+  }
+
+
+  /*! As fft_to( fphidata ), but the P1 map held by the workspace is
+    reused, so that repeated transforms on the same grid do not
+    allocate or plan, and the transform uses the workspace's threads.
+    \param fphidata The reflection data list to set.
+    \param workspace The workspace to use for the transform.
+  */
+  template<class T> template<class H> void Xmap<T>::fft_to( H& fphidata, FFTmap_workspace& workspace ) const
+  {
+    FFTmap_p1& fftmap = workspace.fftmap( grid_sampling() );
+    fft_copy_map( fftmap );
+    fftmap.fft_x_to_h( cell().volume(), workspace.num_threads() );
+    typename H::HKL_reference_index ih;
+    for ( ih = fphidata.first(); !ih.last(); ih.next() ) {
+      std::complex<ffttype> c = fftmap.get_hkl( ih.hkl() );
+      fphidata[ih].f() = std::abs(c);
+      fphidata[ih].phi() = std::arg(c);
+    }
+  }
+
+
+  template<class T> template<class H> void Xmap<T>::fft_copy_hkl( const H& fphidata, FFTmap_p1& fftmap ) const
+  {
+    typename H::HKL_reference_index ih;
+    ffttype f, phi0, phi1;
+    int sym;
+    for ( ih = fphidata.first_data(); !ih.last(); fphidata.next_data( ih ) ) {
+      f = fphidata[ih].f();
+      if ( f != 0.0 ) {
+	phi0 = fphidata[ih].phi();
+	const HKL& hkl = ih.hkl();
+	fftmap.set_hkl( hkl,
+			std::complex<ffttype>( f*cos(phi0), f*sin(phi0) ) );
+	for ( sym = 1; sym < spacegroup_.num_primops(); sym++ ) {
+	  phi1 = phi0 + hkl.sym_phase_shift( spacegroup_.symop(sym) );
+	  fftmap.set_hkl( hkl.transform( isymop[sym] ),
+			  std::complex<ffttype>( f*cos(phi1), f*sin(phi1) ) );
+	}
+      }
+    }
+  }
+
+
+  template<class T> void Xmap<T>::fft_copy_map( FFTmap_p1& fftmap ) const
+  {
+    ffttype f;
+    int sym;
+    for ( Map_reference_index ix = first(); !ix.last(); ix.next() ) {
+      f = (*this)[ix];
+      if ( f != 0.0 ) {
+	fftmap.real_data( ix.coord() ) = f;
+	for ( sym = 1; sym < cacheref.data().nsym; sym++ )
+	  fftmap.real_data(
+            ix.coord().transform( isymop[sym] ).unit( grid_sam_ ) ) = f;
+      }
+    }
+  }
+
+
   /*! All values, including missing values, are overwritten by the value.
     \param value The value to which the map is to be set. */
   template<class T> const T& Xmap<T>::operator =( const T& value )
@@ -10,6 +10,7 @@
 #include "../core/hkl_datatypes.h"
 #include "../core/nxmap.h"
 #include "../core/xmap.h"
+#include "../core/clipper_thread.h"
 #include <gemmi/asudata.hpp> // AsuData
 #include <gemmi/ccp4.hpp>    // Ccp4
 #include <gemmi/mtz.hpp>     // Mtz, math, symmetry, unitcell, <algorithm> and <vector>
@@ -95,11 +96,15 @@ public:
                                                      const std::vector<Miller> &miller_indices);
 
   //! Import map data from gemmi's Ccp4.grid into Xmap
-  template <class T> static void import_xmap(Xmap<T> &xmap, const gemmi::Ccp4<T> &mapobj);
+  template <class T>
+  static void import_xmap(Xmap<T> &xmap, const gemmi::Ccp4<T> &mapobj,
+                          const Execution_policy &exec = Execution_policy());
   //! Import map data from gemmi's Ccp4.grid into NXmap
   template <class T> static void import_nxmap(NXmap<T> &nxmap, const gemmi::Ccp4<T> &mapobj);
   //! Export map data to gemmi's Ccp4.grid from Xmap
-  template <class T> static void export_xmap(const Xmap<T> &xmap, gemmi::Ccp4<T> &mapobj);
+  template <class T>
+  static void export_xmap(const Xmap<T> &xmap, gemmi::Ccp4<T> &mapobj,
+                          const Execution_policy &exec = Execution_policy());
   //! Export map data to gemmi's Ccp4.grid from NXmap
   template <class T> static void export_nxmap(const NXmap<T> &nxmap, gemmi::Ccp4<T> &mapobj, const Cell &unitcell);
 }; // class GEMMI
@@ -107,9 +112,13 @@ public:
 // Implementations templates
 /*! Import grid data from gemmi::Ccp4::grid into Xmap.
     Run setup(0) on gemmi::Ccp4 map object before importing grid data to Xmap.
+    If the gemmi grid then covers the whole cell in xyz order with the
+    same sampling as the Xmap, only the ASU points are read, directly
+    from the grid buffer and in parallel.
   \param xmap The Xmap to be imported.
-  \param mapobj The gemmi::Ccp4 map containing the grid data. */
-template <class T> void GEMMI::import_xmap(Xmap<T> &xmap, const gemmi::Ccp4<T> &mapobj) {
+  \param mapobj The gemmi::Ccp4 map containing the grid data.
+  \param exec The number of threads for the direct copy. */
+template <class T> void GEMMI::import_xmap(Xmap<T> &xmap, const gemmi::Ccp4<T> &mapobj, const Execution_policy &exec) {
   // check if HKL_info params are already set
   Spacegroup s = xmap.spacegroup();
   Cell c = xmap.cell();
@@ -127,6 +136,21 @@ template <class T> void GEMMI::import_xmap(Xmap<T> &xmap, const gemmi::Ccp4<T> &
   if (r.is_null())
     r = Grid_sampling(grid[0], grid[1], grid[2]);
   xmap.init(s, c, r);
+  // full cell with matching sampling: copy the ASU points directly
+  const gemmi::Grid<T> &mapgrid = mapobj.grid;
+  if (mapgrid.axis_order == gemmi::AxisOrder::XYZ && mapgrid.nu == r.nu() && mapgrid.nv == r.nv() &&
+      mapgrid.nw == r.nw()) {
+    std::vector<int> index; // map index of each ASU point
+    for (Xmap_base::Map_reference_index ix = xmap.first(); !ix.last(); ix.next())
+      index.push_back(ix.index());
+    parallel_ranges(int(index.size()), exec.num_threads(), [&](const int &, const int &begin, const int &end) {
+      for (int i = begin; i < end; i++) {
+        const Coord_grid cg = xmap.coord_of(index[i]).unit(r);
+        xmap.set_data(index[i], mapgrid.data[mapgrid.index_q(cg.u(), cg.v(), cg.w())]);
+      }
+    });
+    return;
+  }
   // get grid bound and axis order
   for (int i = 0; i < 3; i++) {
     gfms1[i] = gfms0[i] + dim[i] - 1;
@@ -177,39 +201,38 @@ template <class T> void GEMMI::import_nxmap(NXmap<T> &nxmap, const gemmi::Ccp4<T
 }
 
 /*! Export map data to gemmi's Ccp4::grid from Xmap.
+    The whole cell is written in xyz order, one row at a time, with the
+    sections shared between threads. Every point is taken from the
+    Xmap, so no symmetry expansion is needed afterwards.
   \param xmap The Xmap to be exported.
-  \param mapobj The gemmi::Ccp4 map to hold the grid data.*/
-template <class T> void GEMMI::export_xmap(const Xmap<T> &xmap, gemmi::Ccp4<T> &mapobj) {
-  std::array<int, 3> orderfms, orderxyz, grid, gfms0, gfms1, dim;
-  int spg = xmap.spacegroup().descr().spacegroup_number();
+  \param mapobj The gemmi::Ccp4 map to hold the grid data.
+  \param exec The number of threads for the copy. */
+template <class T> void GEMMI::export_xmap(const Xmap<T> &xmap, gemmi::Ccp4<T> &mapobj, const Execution_policy &exec) {
+  std::array<int, 3> orderfms, grid, gfms0;
+  const Grid_sampling &r = xmap.grid_sampling();
   //  use axis order 1,2,3 (fast, medium, slow) for gemmi Ccp4 map
-  orderxyz = {0, 1, 2};
   orderfms = {1, 2, 3};
-  // grids
-  for (int i = 0; i < 3; i++) {
-    grid[i] = xmap.grid_sampling()[i];
-    gfms0[orderxyz[i]] = xmap.grid_asu().min()[i];
-    gfms1[orderxyz[i]] = xmap.grid_asu().max()[i];
-  }
-  for (int i = 0; i < 3; i++)
-    dim[i] = gfms1[i] - gfms0[i] + 1;
+  gfms0 = {0, 0, 0};
+  grid = {r.nu(), r.nv(), r.nw()};
   // prepare gemmi::Ccp4::grid
-  mapobj.grid.spacegroup = GEMMI::spacegroup(xmap.spacegroup());
-  mapobj.grid.set_unit_cell(cell(xmap.cell()));
-  mapobj.grid.set_size(grid[0], grid[1], grid[2]);
-  mapobj.grid.axis_order = gemmi::AxisOrder::Unknown;
+  gemmi::Grid<T> &mapgrid = mapobj.grid;
+  mapgrid.spacegroup = GEMMI::spacegroup(xmap.spacegroup());
+  mapgrid.set_unit_cell(cell(xmap.cell()));
+  mapgrid.set_size(grid[0], grid[1], grid[2]);
+  mapgrid.axis_order = gemmi::AxisOrder::XYZ;
+  mapgrid.calculate_spacing();
   // copy map data
-  int g[3];
-  Xmap_base::Map_reference_coord x(xmap);
-  for (g[2] = gfms0[2]; g[2] <= gfms1[2]; g[2]++) {
-    for (g[1] = gfms0[1]; g[1] <= gfms1[1]; g[1]++) {
-      for (g[0] = gfms0[0]; g[0] <= gfms1[0]; g[0]++) {
-        x.set_coord(Coord_grid(g[orderxyz[0]], g[orderxyz[1]], g[orderxyz[2]]));
-        mapobj.grid.set_value(g[orderxyz[0]], g[orderxyz[1]], g[orderxyz[2]], T(xmap[x]));
+  parallel_ranges(r.nw(), exec.num_threads(), [&](const int &, const int &begin, const int &end) {
+    for (int w = begin; w < end; w++) {
+      for (int v = 0; v < r.nv(); v++) {
+        Xmap_base::Map_reference_coord x(xmap, Coord_grid(0, v, w));
+        T *row = &mapgrid.data[mapgrid.index_q(0, v, w)];
+        for (int u = 0; u < r.nu(); u++, x.next_u())
+          row[u] = T(xmap[x]);
       }
     }
-  }
-  prepare_gemmi_header(mapobj, dim, gfms0, grid, orderfms, xmap.cell());
+  });
+  prepare_gemmi_header(mapobj, grid, gfms0, grid, orderfms, xmap.cell(), false);
 }
 
 /*! Export map data to gemmi's Ccp4::grid from NXmap.
@@ -260,10 +283,12 @@ template <class T> void GEMMI::export_nxmap(const NXmap<T> &nxmap, gemmi::Ccp4<T
   gfms0 - NXSTART, NYSTART, NZSTART; location of first column, row, section
   grid - full grid size
   orderfms - fast medium slow order
-  unitcell - unit cell */
+  unitcell - unit cell
+  symmetrize - fill symmetry-related points; not needed for a full cell */
 template <class T>
 void prepare_gemmi_header(gemmi::Ccp4<T> &mapobj, std::array<int, 3> dim, std::array<int, 3> gfms0,
-                          std::array<int, 3> grid, std::array<int, 3> orderfms, Cell unitcell) {
+                          std::array<int, 3> grid, std::array<int, 3> orderfms, Cell unitcell,
+                          bool symmetrize = true) {
   mapobj.prepare_ccp4_header_except_mode_and_stats();
   mapobj.set_header_3i32(1, dim[0], dim[1], dim[2]);
   mapobj.set_header_3i32(5, gfms0[0], gfms0[1], gfms0[2]);
@@ -276,7 +301,7 @@ void prepare_gemmi_header(gemmi::Ccp4<T> &mapobj, std::array<int, 3> dim, std::a
   mapobj.set_header_float(15, (float)unitcell.beta_deg());
   mapobj.set_header_float(16, (float)unitcell.gamma_deg());
   mapobj.setup(NAN);
-  if (mapobj.grid.spacegroup->number != 1)
+  if (symmetrize && mapobj.grid.spacegroup->number != 1)
     mapobj.grid.symmetrize_max();
   mapobj.update_ccp4_header(2);
 }
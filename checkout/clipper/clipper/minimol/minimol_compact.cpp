@@ -0,0 +1,167 @@
+/* minimol_compact.cpp: compact minimol storage */
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+
+
+
+#include "minimol_compact.h"
+
+
+namespace clipper {
+
+
+int MString_pool::intern( const String& s )
+{
+  std::map<String,int>::const_iterator it = index.find( s );
+  if ( it != index.end() ) return it->second;
+  int i = strings.size();
+  strings.push_back( s );
+  index[s] = i;
+  return i;
+}
+
+
+/*! \param mol The model to copy.
+  \param properties If true, the properties of the polymers, monomers
+  and atoms are copied too. Since a PropertyManager cannot report
+  whether it is empty, this allocates one for every object. */
+void MiniMol_compact::init( const MiniMol& mol, const bool& properties )
+{
+  spacegroup_ = mol.spacegroup();
+  cell_ = mol.cell();
+  strings = MString_pool();
+  aniso_null = U_aniso_orth( Util::nan() );
+  poly_id.clear(); poly_begin.clear();
+  mono_id.clear(); mono_type.clear(); mono_begin.clear();
+  coord.clear(); occ.clear(); uiso.clear();
+  atom_id.clear(); atom_element.clear(); aniso_index.clear(); aniso.clear();
+  atom_props.clear(); mono_props.clear(); poly_props.clear();
+
+  // count and reserve
+  int nmon = 0, natm = 0;
+  for ( int p = 0; p < mol.size(); p++ ) {
+    nmon += mol[p].size();
+    for ( int m = 0; m < mol[p].size(); m++ ) natm += mol[p][m].size();
+  }
+  poly_id.reserve( mol.size() ); poly_begin.reserve( mol.size() + 1 );
+  mono_id.reserve( nmon ); mono_type.reserve( nmon ); mono_begin.reserve( nmon + 1 );
+  coord.reserve( natm ); occ.reserve( natm ); uiso.reserve( natm );
+  atom_id.reserve( natm ); atom_element.reserve( natm ); aniso_index.reserve( natm );
+
+  // copy the hierarchy
+  for ( int p = 0; p < mol.size(); p++ ) {
+    const MPolymer& mp = mol[p];
+    if ( properties ) poly_props[poly_id.size()].copy( mp );
+    poly_id.push_back( strings.intern( mp.id() ) );
+    poly_begin.push_back( mono_id.size() );
+    for ( int m = 0; m < mp.size(); m++ ) {
+      const MMonomer& mm = mp[m];
+      if ( properties ) mono_props[mono_id.size()].copy( mm );
+      mono_id.push_back( strings.intern( mm.id() ) );
+      mono_type.push_back( strings.intern( mm.type() ) );
+      mono_begin.push_back( coord.size() );
+      for ( int a = 0; a < mm.size(); a++ ) {
+	const MAtom& ma = mm[a];
+	if ( properties ) atom_props[coord.size()].copy( ma );
+	coord.push_back( ma.coord_orth() );
+	occ.push_back( ma.occupancy() );
+	uiso.push_back( ma.u_iso() );
+	atom_id.push_back( strings.intern( ma.id() ) );
+	atom_element.push_back( strings.intern( ma.element() ) );
+	if ( ma.u_aniso_orth().is_null() ) {
+	  aniso_index.push_back( -1 );
+	} else {
+	  aniso_index.push_back( aniso.size() );
+	  aniso.push_back( ma.u_aniso_orth() );
+	}
+      }
+    }
+  }
+  poly_begin.push_back( mono_id.size() );
+  mono_begin.push_back( coord.size() );
+}
+
+
+/*! \return A MiniMol containing the model and any stored properties. */
+MiniMol MiniMol_compact::minimol() const
+{
+  MiniMol mol( spacegroup_, cell_ );
+  for ( int p = 0; p < size(); p++ ) {
+    const MPolymer_view<const MiniMol_compact> vp = (*this)[p];
+    MPolymer mp;
+    mp.set_id( vp.id() );
+    std::map<int,PropertyManager>::const_iterator it = poly_props.find( p );
+    if ( it != poly_props.end() ) mp.PropertyManager::copy( it->second );
+    for ( int m = 0; m < vp.size(); m++ ) {
+      const MMonomer_view<const MiniMol_compact> vm = vp[m];
+      MMonomer mm;
+      mm.set_id( vm.id() );
+      mm.set_type( vm.type() );
+      it = mono_props.find( vm.index() );
+      if ( it != mono_props.end() ) mm.PropertyManager::copy( it->second );
+      for ( int a = 0; a < vm.size(); a++ )
+	mm.insert( vm[a].matom() );
+      mp.insert( mm );
+    }
+    mol.insert( mp );
+  }
+  return mol;
+}
+
+
+Atom_list MiniMol_compact::atom_list() const
+{
+  Atom_list list;
+  list.reserve( num_atoms() );
+  for ( int i = 0; i < num_atoms(); i++ ) list.push_back( atom(i).atom() );
+  return list;
+}
+
+
+void MiniMol_compact::transform( const RTop_orth& rt )
+{
+  for ( int i = 0; i < int(coord.size()); i++ ) coord[i] = rt * coord[i];
+  for ( int i = 0; i < int(aniso.size()); i++ ) aniso[i] = aniso[i].transform( rt );
+}
+
+
+} // namespace clipper
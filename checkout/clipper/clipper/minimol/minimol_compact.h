@@ -0,0 +1,322 @@
+/*! \file minimol_compact.h
+  Header file for compact minimol storage */
+
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+
+
+
+#ifndef CLIPPER_MINIMOL_COMPACT
+#define CLIPPER_MINIMOL_COMPACT
+
+
+#include "minimol_utils.h"
+
+#include <map>
+
+
+namespace clipper {
+
+
+  //! Table of interned strings
+  /*! Each distinct string is stored once and referred to by index. */
+  class MString_pool {
+  public:
+    //! return the index of a string, adding it if necessary
+    int intern( const String& s );
+    //! get string by index
+    const String& operator[] ( const int& i ) const { return strings[i]; }
+    //! number of distinct strings
+    int size() const { return strings.size(); }
+  private:
+    std::vector<String> strings;
+    std::map<String,int> index;
+  };
+
+
+  template<class M> class MAtom_view;
+  template<class M> class MMonomer_view;
+  template<class M> class MPolymer_view;
+
+
+  //! Compact structure-of-arrays storage for a MiniMol model
+  /*! The atoms are held in contiguous arrays of coordinates,
+    occupancies, U-values, element and ID, with monomers and polymers
+    described by ranges of atom and monomer indices. Names and
+    elements are interned, anisotropic U's are only stored for atoms
+    which have them, and a PropertyManager is only allocated for an
+    object when a property is used. This takes a fraction of the
+    memory of a MiniMol and is cheap to copy.
+
+    The model is accessed through lightweight views, which provide
+    the accessors of MPolymer, MMonomer and MAtom:
+    \code
+    clipper::MiniMol_compact cmol( mol );
+    for ( int p = 0; p < cmol.size(); p++ )
+      for ( int m = 0; m < cmol[p].size(); m++ )
+        for ( int a = 0; a < cmol[p][m].size(); a++ )
+          cmol[p][m][a].set_u_iso( u );
+    \endcode
+    The hierarchy itself is fixed when the object is created; use
+    minimol() to obtain an editable MiniMol.
+  */
+  class MiniMol_compact {
+  public:
+    //! null constructor
+    MiniMol_compact() {}
+    //! constructor: from MiniMol, optionally copying properties
+    explicit MiniMol_compact( const MiniMol& mol, const bool& properties = false ) { init( mol, properties ); }
+    //! initialiser: from MiniMol, optionally copying properties
+    void init( const MiniMol& mol, const bool& properties = false );
+    //! return the model as a MiniMol
+    MiniMol minimol() const;
+
+    //! get the cell
+    const Cell& cell() const { return cell_; }
+    //! get the spacegroup
+    const Spacegroup& spacegroup() const { return spacegroup_; }
+
+    //! number of polymers in model
+    int size() const { return poly_id.size(); }
+    //! get polymer
+    MPolymer_view<const MiniMol_compact> operator[] ( const int& i ) const;
+    //! set polymer
+    MPolymer_view<MiniMol_compact> operator[] ( const int& i );
+    //! number of atoms in model
+    int num_atoms() const { return coord.size(); }
+    //! get atom by index in the whole model
+    MAtom_view<const MiniMol_compact> atom( const int& i ) const;
+    //! set atom by index in the whole model
+    MAtom_view<MiniMol_compact> atom( const int& i );
+    //! get the index in the whole model of an atom
+    int atom_index( const MAtomIndex& index ) const
+      { return mono_begin[ poly_begin[index.polymer()] + index.monomer() ] + index.atom(); }
+    //! get the coordinates of all the atoms
+    const std::vector<Coord_orth>& coords() const { return coord; }
+
+    Atom_list atom_list() const;            //!< return list of contained atoms
+    void transform( const RTop_orth& rt );  //!< apply transformation to object
+
+    //! get atom properties, allocating them if necessary
+    PropertyManager& atom_properties( const int& i ) { return atom_props[i]; }
+    //! get monomer properties, allocating them if necessary
+    PropertyManager& monomer_properties( const int& i ) { return mono_props[i]; }
+    //! get polymer properties, allocating them if necessary
+    PropertyManager& polymer_properties( const int& i ) { return poly_props[i]; }
+
+  private:
+    template<class M> friend class MAtom_view;
+    template<class M> friend class MMonomer_view;
+    template<class M> friend class MPolymer_view;
+
+    Spacegroup spacegroup_;
+    Cell cell_;
+    MString_pool strings;            //!< interned names
+    // polymers
+    std::vector<int> poly_id;        //!< polymer ID
+    std::vector<int> poly_begin;     //!< first monomer of each polymer, and end
+    // monomers
+    std::vector<int> mono_id;        //!< monomer ID
+    std::vector<int> mono_type;      //!< monomer type
+    std::vector<int> mono_begin;     //!< first atom of each monomer, and end
+    // atoms
+    std::vector<Coord_orth> coord;   //!< coordinates
+    std::vector<ftype32> occ;        //!< occupancies
+    std::vector<ftype32> uiso;       //!< isotropic U
+    std::vector<int> atom_id;        //!< atom ID
+    std::vector<int> atom_element;   //!< element
+    std::vector<int> aniso_index;    //!< index into aniso, or -1
+    std::vector<U_aniso_orth> aniso; //!< anisotropic U, where present
+    U_aniso_orth aniso_null;         //!< returned for atoms without one
+    // properties, only where used
+    std::map<int,PropertyManager> atom_props, mono_props, poly_props;
+  };
+
+
+  //! Atom view into a MiniMol_compact
+  /*! This provides the accessors of MAtom. The set methods are only
+    available if M is not const. */
+  template<class M> class MAtom_view {
+  public:
+    MAtom_view( M& mol, const int& index ) : mol_(&mol), index_(index) {}
+    //! get atom ID
+    const String& id() const { return mol_->strings[ mol_->atom_id[index_] ]; }
+    //! get atom name, i.e. the ID, omitting any alternate conformation code
+    String name() const { return id().substr(0,4); }
+    const String& element() const { return mol_->strings[ mol_->atom_element[index_] ]; }  //!< get element
+    const Coord_orth& coord_orth() const { return mol_->coord[index_]; }  //!< get orth coordinate
+    ftype occupancy() const { return mol_->occ[index_]; }  //!< get occupancy
+    ftype u_iso() const { return mol_->uiso[index_]; }     //!< get isotropic U
+    //! get anisotropic U
+    const U_aniso_orth& u_aniso_orth() const
+      { const int a = mol_->aniso_index[index_]; return ( a < 0 ) ? mol_->aniso_null : mol_->aniso[a]; }
+    //! set atom ID
+    void set_id( const String& s, bool is_gemmi = false )
+      { mol_->atom_id[index_] = mol_->strings.intern( MAtom::id_tidy( s, is_gemmi ) ); }
+    void set_element( const String& s ) { mol_->atom_element[index_] = mol_->strings.intern( s ); }  //!< set element
+    void set_coord_orth( const Coord_orth& s ) { mol_->coord[index_] = s; }  //!< set coord_orth
+    void set_occupancy( const ftype& s ) { mol_->occ[index_] = s; }          //!< set occupancy
+    void set_u_iso( const ftype& s ) { mol_->uiso[index_] = s; }             //!< set u_iso
+    //! set u_aniso
+    void set_u_aniso_orth( const U_aniso_orth& s )
+      {
+	int& a = mol_->aniso_index[index_];
+	if ( a < 0 ) { a = mol_->aniso.size(); mol_->aniso.push_back( s ); }
+	else         { mol_->aniso[a] = s; }
+      }
+    //! get as a clipper::Atom
+    Atom atom() const { return Atom( *this ); }
+    //! get as a MAtom, including any properties
+    MAtom matom() const
+      {
+	MAtom atom( this->atom() );
+	atom.set_id( id() );
+	typename std::map<int,PropertyManager>::const_iterator it = mol_->atom_props.find( index_ );
+	if ( it != mol_->atom_props.end() ) atom.PropertyManager::copy( it->second );
+	return atom;
+      }
+    //! get index of the atom in the whole model
+    const int& index() const { return index_; }
+  private:
+    M* mol_;
+    int index_;
+  };
+
+
+  //! Monomer view into a MiniMol_compact
+  /*! This provides the accessors of MMonomer. */
+  template<class M> class MMonomer_view {
+  public:
+    MMonomer_view( M& mol, const int& index ) : mol_(&mol), index_(index) {}
+    const String& id() const { return mol_->strings[ mol_->mono_id[index_] ]; }  //!< get monomer ID
+    const String& type() const { return mol_->strings[ mol_->mono_type[index_] ]; }  //!< get monomer type
+    int seqnum() const { return id().i(); }  //!< get monomer seq number
+    //! number of atoms in monomer
+    int size() const { return mol_->mono_begin[index_+1] - mol_->mono_begin[index_]; }
+    //! get atom
+    MAtom_view<M> operator[] ( const int& i ) const { return MAtom_view<M>( *mol_, mol_->mono_begin[index_] + i ); }
+    //! lookup atom by id
+    int lookup( const String& str, const MM::MODE& mode ) const
+      {
+	String sid = MAtom::id_tidy( str );
+	for ( int i = 0; i < size(); i++ )
+	  if ( MAtom::id_match( sid, (*this)[i].id(), mode ) ) return i;
+	return -1;
+      }
+    //! get atom by id
+    MAtom_view<M> find( const String& n, const MM::MODE mode=MM::UNIQUE ) const
+      {
+	int i = lookup( n, mode );
+	if ( i < 0 ) Message::message(Message_fatal("MMonomer: no such atom"));
+	return (*this)[i];
+      }
+    //! return list of contained atoms
+    Atom_list atom_list() const
+      {
+	Atom_list list;
+	for ( int i = 0; i < size(); i++ ) list.push_back( (*this)[i].atom() );
+	return list;
+      }
+    //! get index of the monomer in the whole model
+    const int& index() const { return index_; }
+  private:
+    M* mol_;
+    int index_;
+  };
+
+
+  //! Polymer view into a MiniMol_compact
+  /*! This provides the accessors of MPolymer. */
+  template<class M> class MPolymer_view {
+  public:
+    MPolymer_view( M& mol, const int& index ) : mol_(&mol), index_(index) {}
+    const String& id() const { return mol_->strings[ mol_->poly_id[index_] ]; }  //!< get polymer ID
+    //! number of monomers in polymer
+    int size() const { return mol_->poly_begin[index_+1] - mol_->poly_begin[index_]; }
+    //! get monomer
+    MMonomer_view<M> operator[] ( const int& i ) const { return MMonomer_view<M>( *mol_, mol_->poly_begin[index_] + i ); }
+    //! lookup monomer by id
+    int lookup( const String& str, const MM::MODE& mode ) const
+      {
+	String sid = MMonomer::id_tidy( str );
+	for ( int i = 0; i < size(); i++ )
+	  if ( MMonomer::id_match( sid, (*this)[i].id(), mode ) ) return i;
+	return -1;
+      }
+    //! get monomer by id
+    MMonomer_view<M> find( const String& n, const MM::MODE mode=MM::UNIQUE ) const
+      {
+	int i = lookup( n, mode );
+	if ( i < 0 ) Message::message(Message_fatal("MPolymer: no such monomer"));
+	return (*this)[i];
+      }
+    //! return list of contained atoms
+    Atom_list atom_list() const
+      {
+	Atom_list list;
+	for ( int i = 0; i < size(); i++ ) {
+	  Atom_list a = (*this)[i].atom_list();
+	  list.insert( list.end(), a.begin(), a.end() );
+	}
+	return list;
+      }
+    //! get index of the polymer in the whole model
+    const int& index() const { return index_; }
+  private:
+    M* mol_;
+    int index_;
+  };
+
+
+  inline MPolymer_view<const MiniMol_compact> MiniMol_compact::operator[] ( const int& i ) const
+    { return MPolymer_view<const MiniMol_compact>( *this, i ); }
+  inline MPolymer_view<MiniMol_compact> MiniMol_compact::operator[] ( const int& i )
+    { return MPolymer_view<MiniMol_compact>( *this, i ); }
+  inline MAtom_view<const MiniMol_compact> MiniMol_compact::atom( const int& i ) const
+    { return MAtom_view<const MiniMol_compact>( *this, i ); }
+  inline MAtom_view<MiniMol_compact> MiniMol_compact::atom( const int& i )
+    { return MAtom_view<MiniMol_compact>( *this, i ); }
+
+
+} // namespace clipper
+
+#endif
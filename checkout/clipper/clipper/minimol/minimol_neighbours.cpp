@@ -0,0 +1,245 @@
+/* minimol_neighbours.cpp: cell-list neighbour search for minimol */
+//C Copyright (C) 2000-2006 Kevin Cowtan and University of York
+//L
+//L  This library is free software and is distributed under the terms
+//L  and conditions of version 2.1 of the GNU Lesser General Public
+//L  Licence (LGPL) with the following additional clause:
+//L
+//L     `You may also combine or link a "work that uses the Library" to
+//L     produce a work containing portions of the Library, and distribute
+//L     that work under terms of your choice, provided that you give
+//L     prominent notice with each copy of the work that the specified
+//L     version of the Library is used in it, and that you include or
+//L     provide public access to the complete corresponding
+//L     machine-readable source code for the Library including whatever
+//L     changes were used in the work. (i.e. If you make changes to the
+//L     Library you must distribute those, but you do not need to
+//L     distribute source or object code to those portions of the work
+//L     not covered by this licence.)'
+//L
+//L  Note that this clause grants an additional right and does not impose
+//L  any additional restriction, and so does not affect compatibility
+//L  with the GNU General Public Licence (GPL). If you wish to negotiate
+//L  other terms, please contact the maintainer.
+//L
+//L  You can redistribute it and/or modify the library under the terms of
+//L  the GNU Lesser General Public License as published by the Free Software
+//L  Foundation; either version 2.1 of the License, or (at your option) any
+//L  later version.
+//L
+//L  This library is distributed in the hope that it will be useful, but
+//L  WITHOUT ANY WARRANTY; without even the implied warranty of
+//L  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//L  Lesser General Public License for more details.
+//L
+//L  You should have received a copy of the CCP4 licence and/or GNU
+//L  Lesser General Public License along with this library; if not, write
+//L  to the CCP4 Secretary, Daresbury Laboratory, Warrington WA4 4AD, UK.
+//L  The GNU Lesser General Public can also be obtained by writing to the
+//L  Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+//L  MA 02111-1307 USA
+
+
+
+
+
+#include "minimol_utils.h"
+
+
+namespace clipper {
+
+
+namespace {
+
+  // atom image: cell index and coordinate in the unit cell
+  struct Image { int cell; Coord_orth xyz; };
+
+  class Make_images {
+  public:
+    Make_images( const std::vector<Coord_orth>& xyz, const Spacegroup& spgr, const Cell& cell, const Grid& grid, std::vector<Image>& images ) : xyz_(xyz), spgr_(spgr), cell_(cell), grid_(grid), images_(images) {}
+    void operator() ( const int&, const int& begin, const int& end ) const
+    {
+      const int nsym = spgr_.num_symops();
+      for ( int i = begin; i < end; i++ ) {
+	const Coord_frac f0 = xyz_[i].coord_frac( cell_ );
+	for ( int s = 0; s < nsym; s++ ) {
+	  Coord_frac f = spgr_.symop(s) * f0;
+	  f = Coord_frac( f.u() - floor( f.u() ), f.v() - floor( f.v() ), f.w() - floor( f.w() ) );
+	  const Coord_grid c( Util::min( Util::intf( f.u() * grid_.nu() ), grid_.nu() - 1 ),
+			      Util::min( Util::intf( f.v() * grid_.nv() ), grid_.nv() - 1 ),
+			      Util::min( Util::intf( f.w() * grid_.nw() ), grid_.nw() - 1 ) );
+	  Image& im = images_[ i*nsym + s ];
+	  im.cell = grid_.index( c );
+	  im.xyz = f.coord_orth( cell_ );
+	}
+      }
+    }
+  private:
+    const std::vector<Coord_orth>& xyz_;
+    const Spacegroup& spgr_;
+    const Cell& cell_;
+    const Grid& grid_;
+    std::vector<Image>& images_;
+  };
+
+  // count the images in each cell, per thread
+  class Count_images {
+  public:
+    Count_images( const std::vector<Image>& images, std::vector<std::vector<int> >& counts ) : images_(images), counts_(counts) {}
+    void operator() ( const int& chunk, const int& begin, const int& end ) const
+    {
+      std::vector<int>& count = counts_[chunk];
+      for ( int i = begin; i < end; i++ ) count[ images_[i].cell ]++;
+    }
+  private:
+    const std::vector<Image>& images_;
+    std::vector<std::vector<int> >& counts_;
+  };
+
+  // scatter the images into cell order, per thread
+  template<class E> class Scatter_images {
+  public:
+    Scatter_images( const std::vector<Image>& images, const std::vector<MAtomIndex>& index, const int& nsym, std::vector<std::vector<int> >& next, std::vector<E>& entries ) : images_(images), index_(index), nsym_(nsym), next_(next), entries_(entries) {}
+    void operator() ( const int& chunk, const int& begin, const int& end ) const
+    {
+      std::vector<int>& next = next_[chunk];
+      for ( int i = begin; i < end; i++ ) {
+	E& e = entries_[ next[ images_[i].cell ]++ ];
+	const MAtomIndex& a = index_[ i / nsym_ ];
+	e.xyz = images_[i].xyz;
+	e.index = MAtomIndexSymmetry( a.polymer(), a.monomer(), a.atom(), i % nsym_ );
+      }
+    }
+  private:
+    const std::vector<Image>& images_;
+    const std::vector<MAtomIndex>& index_;
+    int nsym_;
+    std::vector<std::vector<int> >& next_;
+    std::vector<E>& entries_;
+  };
+
+  // append atom indices to a result vector
+  class Collect {
+  public:
+    Collect( std::vector<MAtomIndexSymmetry>& result ) : result_(result) {}
+    void operator() ( const MAtomIndexSymmetry& a, const Coord_orth&, const ftype& ) { result_.push_back( a ); }
+  private:
+    std::vector<MAtomIndexSymmetry>& result_;
+  };
+
+} // anonymous namespace
+
+
+/*! The symmetry copies are generated and sorted into cells in
+  parallel. Within each cell the images are in atom and symmetry
+  order, whatever the number of threads.
+  \param mol The model to search.
+  \param rad The minimum width of a cell. This should be similar to
+  the typical search radius.
+  \param exec The number of threads for construction. */
+void MAtomNeighbourSearch::init( const MiniMol& mol, const ftype& rad, const Execution_policy& exec )
+{
+  cell = mol.cell();
+  const Spacegroup& spgr = mol.spacegroup();
+  const int nsym = spgr.num_symops();
+  grid = Grid( Util::max( Util::intf( 1.0 / ( cell.a_star() * rad ) ), 1 ),
+	       Util::max( Util::intf( 1.0 / ( cell.b_star() * rad ) ), 1 ),
+	       Util::max( Util::intf( 1.0 / ( cell.c_star() * rad ) ), 1 ) );
+
+  // flatten the model
+  std::vector<Coord_orth> xyz;
+  std::vector<MAtomIndex> index;
+  for ( int p = 0; p < mol.size(); p++ )
+    for ( int m = 0; m < mol[p].size(); m++ )
+      for ( int a = 0; a < mol[p][m].size(); a++ ) {
+	xyz.push_back( mol[p][m][a].coord_orth() );
+	index.push_back( MAtomIndex( p, m, a ) );
+      }
+
+  // generate images
+  const int nthd = Util::max( exec.num_threads(), 1 );
+  const int nimg = xyz.size() * nsym;
+  std::vector<Image> images( nimg );
+  parallel_ranges( xyz.size(), nthd, Make_images( xyz, spgr, cell, grid, images ) );
+
+  // counting sort by cell: thread t's images in cell c go after those
+  // of threads < t, so the order is independent of the thread count
+  const int nchunk = Util::max( Util::min( nthd, nimg ), 1 );
+  std::vector<std::vector<int> > counts( nchunk, std::vector<int>( grid.size(), 0 ) );
+  parallel_ranges( nimg, nthd, Count_images( images, counts ) );
+  start.assign( grid.size() + 1, 0 );
+  int n = 0;
+  for ( int c = 0; c < grid.size(); c++ ) {
+    start[c] = n;
+    for ( int t = 0; t < nchunk; t++ ) {
+      const int k = counts[t][c];
+      counts[t][c] = n;
+      n += k;
+    }
+  }
+  start[grid.size()] = n;
+  entries.resize( nimg );
+  parallel_ranges( nimg, nthd, Scatter_images<Entry>( images, index, nsym, counts, entries ) );
+}
+
+/*! \param co The coordinate to search around.
+  \param rad The search radius.
+  \param result Cleared and filled with the atoms within rad of co. */
+void MAtomNeighbourSearch::atoms_near( const Coord_orth& co, const ftype& rad, std::vector<MAtomIndexSymmetry>& result ) const
+{
+  result.clear();
+  Collect collect( result );
+  visit( co, rad, collect );
+}
+
+/*! The results for centre i are result[offsets[i]] to
+  result[offsets[i+1]-1]. The output vectors are reused, so repeated
+  calls do not allocate once they have grown.
+  \param co The coordinates to search around.
+  \param rad The search radius.
+  \param offsets Returns the first result for each centre, and the end.
+  \param result Returns the atoms within rad of each centre.
+  \param exec The number of threads. */
+void MAtomNeighbourSearch::atoms_near( const std::vector<Coord_orth>& co, const ftype& rad, std::vector<int>& offsets, std::vector<MAtomIndexSymmetry>& result, const Execution_policy& exec ) const
+{
+  struct Search {
+    const MAtomNeighbourSearch& nb; const std::vector<Coord_orth>& co; const ftype& rad;
+    std::vector<std::vector<MAtomIndexSymmetry> >& part; std::vector<int>& offsets;
+    void operator() ( const int& chunk, const int& begin, const int& end ) const
+    {
+      std::vector<MAtomIndexSymmetry>& r = part[chunk];
+      Collect collect( r );
+      for ( int i = begin; i < end; i++ ) {
+	offsets[i] = r.size();
+	nb.visit( co[i], rad, collect );
+      }
+    }
+  };
+  const int n = co.size();
+  const int nthd = Util::max( Util::min( exec.num_threads(), n ), 1 );
+  offsets.resize( n + 1 );
+  result.clear();
+  if ( nthd == 1 ) {
+    // single thread: write straight into the result
+    Collect collect( result );
+    for ( int i = 0; i < n; i++ ) {
+      offsets[i] = result.size();
+      visit( co[i], rad, collect );
+    }
+  } else {
+    // each thread fills its own part, then the parts are joined in order
+    std::vector<std::vector<MAtomIndexSymmetry> > part( nthd );
+    Search search = { *this, co, rad, part, offsets };
+    parallel_ranges( n, nthd, search );
+    for ( int t = 0; t < nthd; t++ ) {
+      const int base = result.size();
+      const int begin = int( (long long)n*t/nthd ), end = int( (long long)n*(t+1)/nthd );
+      for ( int i = begin; i < end; i++ ) offsets[i] += base;
+      result.insert( result.end(), part[t].begin(), part[t].end() );
+    }
+  }
+  offsets[n] = result.size();
+}
+
+
+} // namespace clipper
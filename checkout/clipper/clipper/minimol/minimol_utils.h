@@ -47,6 +47,7 @@
 
 
 #include "minimol.h"
+#include "../core/clipper_thread.h"
 
 
 namespace clipper {
@@ -108,6 +109,105 @@ namespace clipper {
     std::vector<MAtomIndexSymmetry> atoms;
   };
 
+  //! Cell-list neighbour search for a MiniMol, including symmetry
+  /*! All the symmetry copies of the atoms are sorted into a grid of
+    cells covering the unit cell, with each cell at least the given
+    radius across. A query only visits the cells which can contain
+    atoms within the query radius, and passes each atom found to a
+    visitor together with the coordinates of the nearby image, so no
+    memory is allocated per query:
+    \code
+    struct Count {
+      int n;
+      void operator() ( const MAtomIndexSymmetry& a, const Coord_orth& xyz, const ftype& d2 ) { n++; }
+    } count = { 0 };
+    clipper::MAtomNeighbourSearch nb( mol, 4.0, clipper::Execution_policy( 4 ) );
+    nb.visit( centre, 4.0, count );
+    \endcode
+    Unlike MAtomNonBond, only atoms within the radius are returned.
+    The search object may be queried from several threads at once.
+  */
+  class MAtomNeighbourSearch {
+  public:
+    //! null constructor
+    MAtomNeighbourSearch() {}
+    //! constructor: from MiniMol and cell radius
+    MAtomNeighbourSearch( const MiniMol& mol, const ftype& rad = 5.0, const Execution_policy& exec = Execution_policy() ) { init( mol, rad, exec ); }
+    //! initialiser: from MiniMol and cell radius
+    void init( const MiniMol& mol, const ftype& rad = 5.0, const Execution_policy& exec = Execution_policy() );
+
+    //! call visitor( index, coord, dist^2 ) for each atom image near a coordinate
+    template<class V> void visit( const Coord_orth& co, const ftype& rad, V& visitor ) const;
+    //! call visitor( centre, index, coord, dist^2 ) for each atom image near each centre
+    template<class V> void visit( const std::vector<Coord_orth>& co, const ftype& rad, V& visitor ) const;
+    //! get the atoms near a coordinate, reusing the result vector
+    void atoms_near( const Coord_orth& co, const ftype& rad, std::vector<MAtomIndexSymmetry>& result ) const;
+    //! get the atoms near each of several coordinates
+    void atoms_near( const std::vector<Coord_orth>& co, const ftype& rad, std::vector<int>& offsets, std::vector<MAtomIndexSymmetry>& result, const Execution_policy& exec = Execution_policy() ) const;
+  private:
+    //! an atom image in the unit cell
+    struct Entry { Coord_orth xyz; MAtomIndexSymmetry index; };
+    Cell cell;
+    Grid grid;                   //!< cells along each axis
+    std::vector<int> start;      //!< first entry of each cell, and end
+    std::vector<Entry> entries;  //!< atom images sorted by cell
+  };
+
+
+  /*! \param co The coordinate to search around.
+    \param rad The search radius.
+    \param visitor Called as visitor( index, coord, dist^2 ) for each
+    atom image within rad of co. */
+  template<class V> void MAtomNeighbourSearch::visit( const Coord_orth& co, const ftype& rad, V& visitor ) const
+  {
+    if ( entries.empty() ) return;
+    const ftype r2 = rad * rad;
+    const Coord_frac f = co.coord_frac( cell );
+    const int u0 = Util::intf( ( f.u() - rad * cell.a_star() ) * grid.nu() );
+    const int u1 = Util::intf( ( f.u() + rad * cell.a_star() ) * grid.nu() );
+    const int v0 = Util::intf( ( f.v() - rad * cell.b_star() ) * grid.nv() );
+    const int v1 = Util::intf( ( f.v() + rad * cell.b_star() ) * grid.nv() );
+    const int w0 = Util::intf( ( f.w() - rad * cell.c_star() ) * grid.nw() );
+    const int w1 = Util::intf( ( f.w() + rad * cell.c_star() ) * grid.nw() );
+    for ( int u = u0; u <= u1; u++ ) {
+      const int cu = Util::mod( u, grid.nu() );
+      for ( int v = v0; v <= v1; v++ ) {
+	const int cv = Util::mod( v, grid.nv() );
+	for ( int w = w0; w <= w1; w++ ) {
+	  const int cw = Util::mod( w, grid.nw() );
+	  // lattice translation of this cell relative to the unit cell
+	  const Coord_orth shift = Coord_frac( ftype( ( u - cu ) / grid.nu() ),
+					       ftype( ( v - cv ) / grid.nv() ),
+					       ftype( ( w - cw ) / grid.nw() ) ).coord_orth( cell );
+	  const Coord_orth c0 = co - shift;
+	  const int c = grid.index( Coord_grid( cu, cv, cw ) );
+	  for ( int i = start[c]; i < start[c+1]; i++ ) {
+	    const ftype d2 = ( entries[i].xyz - c0 ).lengthsq();
+	    if ( d2 <= r2 ) visitor( entries[i].index, entries[i].xyz + shift, d2 );
+	  }
+	}
+      }
+    }
+  }
+
+  /*! \param co The coordinates to search around.
+    \param rad The search radius.
+    \param visitor Called as visitor( centre, index, coord, dist^2 )
+    for each atom image within rad of each centre, where centre is the
+    index into co. */
+  template<class V> void MAtomNeighbourSearch::visit( const std::vector<Coord_orth>& co, const ftype& rad, V& visitor ) const
+  {
+    struct Bound {
+      V& v; int i;
+      void operator() ( const MAtomIndexSymmetry& a, const Coord_orth& x, const ftype& d2 ) { v( i, a, x, d2 ); }
+    };
+    for ( int i = 0; i < int(co.size()); i++ ) {
+      Bound bound = { visitor, i };
+      visit( co[i], rad, bound );
+    }
+  }
+
+
 } // namespace clipper
 
 #endif
@@ -0,0 +1,93 @@
+// Check: compare FFFear_fft_threaded with FFFear_fft
+
+
+#include <clipper/clipper.h>
+#include <clipper/clipper-contrib.h>
+
+#include <cstdlib>
+#include <iostream>
+
+
+using namespace clipper;
+
+
+// largest difference between two score maps, relative to the score range
+ftype compare( const Xmap<float>& a, const Xmap<float>& b )
+{
+  ftype dmax = 0.0, amin = 1.0e30, amax = -1.0e30;
+  for ( Xmap<float>::Map_reference_index ix = a.first(); !ix.last(); ix.next() ) {
+    amin = Util::min( amin, ftype( a[ix] ) );
+    amax = Util::max( amax, ftype( a[ix] ) );
+    dmax = Util::max( dmax, fabs( ftype( a[ix] ) - ftype( b[ix] ) ) );
+  }
+  return dmax / Util::max( amax - amin, 1.0e-6 );
+}
+
+
+int main()
+{
+  const Spacegroup spgr( Spgr_descr( "P 21 21 21" ) );
+  const Cell cell( Cell_descr( 24.0, 28.0, 32.0 ) );
+  const Grid_sampling grid( spgr, cell, Resolution( 2.5 ) );
+
+  // map from random atoms
+  Atom_list atoms;
+  for ( int i = 0; i < 40; i++ ) {
+    Atom atom = Atom::null();
+    atom.set_element( "C" );
+    atom.set_coord_orth( Coord_frac( rand() / double( RAND_MAX ),
+				     rand() / double( RAND_MAX ),
+				     rand() / double( RAND_MAX ) ).coord_orth( cell ) );
+    atom.set_occupancy( 1.0 );
+    atom.set_u_iso( 0.25 );
+    atoms.push_back( atom );
+  }
+  Xmap<float> xmap( spgr, cell, grid );
+  EDcalc_iso<float>()( xmap, atoms );
+
+  // search target: a sphere cut from the map, with unit weights
+  const Grid_range box( Coord_grid( -4, -4, -4 ), Coord_grid( 4, 4, 4 ) );
+  NXmap<float> srchval( cell, grid, box ), srchwgt( cell, grid, box );
+  for ( NXmap<float>::Map_reference_index ix = srchval.first(); !ix.last(); ix.next() ) {
+    const Coord_grid d = ix.coord() - Coord_grid( 4, 4, 4 );
+    srchval[ix] = xmap.interp<Interp_linear>( ix.coord_orth().coord_frac( cell ) );
+    srchwgt[ix] = ( d.u()*d.u() + d.v()*d.v() + d.w()*d.w() <= 16 ) ? 1.0 : 0.0;
+  }
+
+  std::vector<RTop_orth> rtops;
+  rtops.push_back( RTop_orth( Rotation::zero().matrix(), Coord_orth( 0.0, 0.0, 0.0 ) ) );
+  rtops.push_back( RTop_orth( Rotation( Euler<Rotation::EulerZYZr>( 0.3, 0.5, 0.7 ) ).matrix(), Coord_orth( 0.0, 0.0, 0.0 ) ) );
+
+  const ftype tol = 1.0e-3;
+  bool ok = true;
+  const char* types[] = { "normal", "sparse" };
+  for ( int t = 0; t < 2; t++ )
+    for ( int r = 0; r < 2; r++ ) {
+      FFFear_fft<float> ref( xmap );
+      ref.set_fft_type( t == 0 ? FFFear_fft<float>::Normal : FFFear_fft<float>::Sparse );
+      if ( r ) ref.set_resolution( Resolution( 3.5 ) );
+      for ( int nthd = 1; nthd <= 4; nthd += 3 ) {
+	FFFear_fft_threaded<float> thr( xmap, Execution_policy( nthd ) );
+	thr.set_fft_type( t == 0 ? FFFear_fft_threaded<float>::Normal : FFFear_fft_threaded<float>::Sparse );
+	if ( r ) thr.set_resolution( Resolution( 3.5 ) );
+	std::vector<Xmap<float> > results;
+	thr( results, srchval, srchwgt, rtops );
+	for ( int i = 0; i < int(rtops.size()); i++ ) {
+	  Xmap<float> r0( spgr, cell, grid ), r1( spgr, cell, grid );
+	  ref( r0, srchval, srchwgt, rtops[i] );
+	  thr( r1, srchval, srchwgt, rtops[i] );
+	  const ftype d1 = compare( r0, r1 );
+	  const ftype dn = compare( r0, results[i] );
+	  std::cout << types[t] << ( r ? " 3.5A" : " full" ) << " threads " << nthd
+		    << " rtop " << i << ": " << d1 << " " << dn << "\n";
+	  if ( !( d1 <= tol && dn <= tol ) ) ok = false;
+	}
+      }
+    }
+
+  if ( !ok ) {
+    std::cout << "Error: FFFear_fft_threaded differs from FFFear_fft\n";
+    return 1;
+  }
+  return 0;
+}
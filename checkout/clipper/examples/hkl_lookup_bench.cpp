@@ -0,0 +1,79 @@
+// Benchmark: compare HKL_lookup with HKL_lookup_flat
+
+
+#include <clipper/clipper.h>
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+
+using clipper::HKL;
+
+
+double seconds( clock_t t0 ) { return double( clock() - t0 ) / CLOCKS_PER_SEC; }
+
+
+int main( int argc, char** argv )
+{
+  // reflections within a sphere of radius r, half sphere if argv[2] == "h"
+  int r = ( argc > 1 ) ? atoi( argv[1] ) : 40;
+  bool half = ( argc > 2 && argv[2][0] == 'h' );
+  std::vector<HKL> hkls;
+  for ( int h = -r; h <= r; h++ )
+    for ( int k = -r; k <= r; k++ )
+      for ( int l = ( half ? 0 : -r ); l <= r; l++ )
+        if ( h*h + k*k + l*l <= r*r ) hkls.push_back( HKL( h, k, l ) );
+
+  // queries: the reflections in random order, plus some absent ones
+  std::vector<HKL> query( hkls );
+  for ( int i = 0; i < int(query.size()); i++ ) {
+    int j = i + rand() % ( query.size() - i );
+    std::swap( query[i], query[j] );
+  }
+  for ( int i = 0; i < int(query.size()); i += 8 )
+    query[i] = HKL( query[i].h(), query[i].k(), -query[i].l() - 1 );
+  const int ncycle = 20;
+
+  clock_t t0 = clock();
+  clipper::HKL_lookup lookup;
+  lookup.init( hkls );
+  double t_init = seconds( t0 );
+  t0 = clock();
+  long sum = 0;
+  for ( int c = 0; c < ncycle; c++ )
+    for ( int i = 0; i < int(query.size()); i++ )
+      sum += lookup.index_of( query[i] );
+  double t_find = seconds( t0 );
+
+  t0 = clock();
+  clipper::HKL_lookup_flat flat;
+  flat.init( hkls );
+  double t_init_flat = seconds( t0 );
+  t0 = clock();
+  long sum_flat = 0;
+  for ( int c = 0; c < ncycle; c++ )
+    for ( int i = 0; i < int(query.size()); i++ )
+      sum_flat += flat.index_of( query[i] );
+  double t_find_flat = seconds( t0 );
+
+  t0 = clock();
+  long sum_batch = 0;
+  std::vector<int> index;
+  for ( int c = 0; c < ncycle; c++ ) {
+    flat.index_of( query, index );
+    for ( int i = 0; i < int(index.size()); i++ ) sum_batch += index[i];
+  }
+  double t_batch = seconds( t0 );
+
+  std::cout << hkls.size() << " reflections, " << ncycle * query.size() << " lookups, "
+            << ( flat.is_dense() ? "dense" : "hash" ) << " table\n";
+  std::cout << "HKL_lookup       init " << t_init << "s  lookup " << t_find << "s\n";
+  std::cout << "HKL_lookup_flat  init " << t_init_flat << "s  lookup " << t_find_flat
+            << "s  batch " << t_batch << "s\n";
+  if ( sum != sum_flat || sum != sum_batch ) {
+    std::cout << "Error: results differ\n";
+    return 1;
+  }
+  return 0;
+}
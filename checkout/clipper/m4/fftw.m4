@@ -68,3 +68,47 @@ AC_LANG_POP(C++)
 LIBS="$saved_LIBS"
 AC_SUBST(FFTW2_LIBS)
 ])
+
+# SYNOPSIS
+#
+#   SINGLE_FFTW2_THREADS
+#
+# DESCRIPTION
+#
+#   Test for the FFTW2 threads libraries matching the libraries found by
+#   SINGLE_FFTW2, which must be called first. Threads are optional: if the
+#   libraries are found they are prepended to FFTW2_LIBS and FFTW2_THREADS
+#   is defined (AC_DEFINE), otherwise the threaded transforms in FFTmap_p1
+#   run on a single thread. Call after AX_PTHREAD.
+#
+# LICENSE
+#
+#   Public Domain
+#
+
+AC_DEFUN([SINGLE_FFTW2_THREADS],
+[
+saved_LIBS="$LIBS"
+AC_LANG_PUSH(C++)
+
+if test "x$have_fftw" = xyes; then
+  FFTW2_THREADS_LIBS="-lsrfftw_threads -lsfftw_threads"
+  fftw2_threads_header="srfftw_threads.h"
+else
+  FFTW2_THREADS_LIBS="-lrfftw_threads -lfftw_threads"
+  fftw2_threads_header="rfftw_threads.h"
+fi
+AC_MSG_CHECKING([for FFTW2 threads ($FFTW2_THREADS_LIBS)])
+LIBS="$FFTW2_THREADS_LIBS $FFTW2_LIBS $PTHREAD_LIBS $saved_LIBS"
+AC_TRY_LINK([#include <$fftw2_threads_header>],
+            [return fftw_threads_init()],
+            have_fftw_threads=yes, have_fftw_threads=no)
+AC_MSG_RESULT($have_fftw_threads)
+if test $have_fftw_threads = yes; then
+  AC_DEFINE(FFTW2_THREADS, 1, [Define if FFTW2 threads are available.])
+  FFTW2_LIBS="$FFTW2_THREADS_LIBS $FFTW2_LIBS"
+fi
+
+AC_LANG_POP(C++)
+LIBS="$saved_LIBS"
+])
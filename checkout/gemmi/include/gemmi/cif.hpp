@@ -1,7 +1,8 @@
 // Copyright 2017 Global Phasing Ltd.
 //
 // CIF parser (based on PEGTL) with pluggable actions,
-// and a set of actions that prepare Document.
+// a set of actions that prepare Document,
+// and SAX-style callbacks (SaxHandler) that don't build Document.
 
 #ifndef GEMMI_CIF_HPP_
 #define GEMMI_CIF_HPP_
@@ -9,15 +10,14 @@
 #include <cstdio>     // for FILE
 #include <iosfwd>     // for size_t, istream
 #include <string>
+#include <vector>
 
 #include "third_party/tao/pegtl.hpp"
 //#include "third_party/tao/pegtl/contrib/tracer.hpp"  // for debugging
 
 #include "cifdoc.hpp" // for Document, etc
 #include "input.hpp"  // for CharArray
-#if defined(_WIN32)
-#include "fileutil.hpp" // for file_open
-#endif
+#include "fileutil.hpp" // for file_open, read_stdin_into_buffer
 
 #if defined(_MSC_VER)
 #pragma warning(push)
@@ -351,6 +351,20 @@ Document read(T&& input) {
   return read_file(input.path());
 }
 
+// Parses text as it is produced by reader(char* buf, size_t len), which
+// returns the number of bytes copied (0 at the end), e.g. GzStreamReader.
+// The whole text is never in memory; bufsize limits the look-ahead.
+template<typename Reader>
+struct ReaderRef {
+  Reader* reader;
+  size_t operator()(char* buf, size_t len) { return (*reader)(buf, len); }
+};
+template<typename Reader>
+Document read_reader(Reader& reader, size_t bufsize, const char* name) {
+  pegtl::buffer_input<ReaderRef<Reader>> in(name, bufsize, ReaderRef<Reader>{&reader});
+  return read_input(in);
+}
+
 template<typename T>
 bool check_syntax_any(T&& input, std::string* msg) {
   if (CharArray mem = input.uncompress_into_buffer()) {
@@ -374,6 +388,203 @@ size_t read_one_block(Document& d, T&& input, size_t limit) {
   return parse_one_block(d, std::move(in));
 }
 
+// **** SAX-style parsing without building a Document ****
+
+// Non-owning reference to a token in the input (a tag or a raw value,
+// with quotes if the value is quoted, cf. as_string()).
+// Valid only as long as the input buffer.
+struct StrView {
+  const char* ptr;
+  size_t len;
+  const char* data() const { return ptr; }
+  size_t size() const { return len; }
+  bool empty() const { return len == 0; }
+  char operator[](size_t i) const { return ptr[i]; }
+  std::string str() const { return std::string(ptr, len); }
+  bool operator==(const std::string& s) const {
+    return s.size() == len && s.compare(0, len, ptr, len) == 0;
+  }
+  bool operator!=(const std::string& s) const { return !(*this == s); }
+};
+
+// Base class with no-op callbacks. Derive from it and hide the functions
+// that are needed. The handler is used as a template parameter,
+// so the calls are not virtual.
+struct SaxHandler {
+  void start_block(StrView /*name*/) {}
+  void start_frame(StrView /*name*/) {}
+  void end_frame() {}
+  void pair(StrView /*tag*/, StrView /*value*/) {}
+  void start_loop() {}
+  void loop_tag(StrView /*tag*/) {}
+  void loop_row(const StrView* /*values*/, size_t /*n*/) {}
+  void end_loop() {}
+};
+
+template<typename Handler>
+struct SaxState {
+  Handler& handler;
+  // lowercase category names with trailing dot ("_atom_site."); empty = all
+  // (the dot is added if missing, as in Block::find_mmcif_category())
+  std::vector<std::string> categories;
+  StrView pair_tag = {nullptr, 0};
+  bool skip_pair = false;
+  bool skip_loop = false;
+  std::vector<StrView> row;
+  size_t column = 0;
+
+  SaxState(Handler& h, const std::vector<std::string>& cats)
+    : handler(h), categories(cats) {
+    for (std::string& cat : categories) {
+      ensure_mmcif_category(cat);
+      cat = to_lower(cat);
+    }
+  }
+
+  bool is_wanted(const StrView& tag) const {
+    if (categories.empty())
+      return true;
+    for (const std::string& cat : categories)
+      if (tag.size() >= cat.size() &&
+          std::equal(cat.begin(), cat.end(), tag.data(),
+                     [](char c1, char c2) { return c1 == lower(c2); }))
+        return true;
+    return false;
+  }
+};
+
+template<typename Input> StrView to_view(const Input& in) {
+  return StrView{in.begin(), in.size()};
+}
+
+template<typename Rule> struct SaxAction : pegtl::nothing<Rule> {};
+
+template<> struct SaxAction<rules::datablockname> {
+  template<typename Input, typename State>
+  static void apply(const Input& in, State& st) {
+    st.handler.start_block(to_view(in));
+  }
+};
+template<> struct SaxAction<rules::str_global> {
+  template<typename Input, typename State>
+  static void apply(const Input& in, State& st) {
+    st.handler.start_block(StrView{in.begin(), 0});
+  }
+};
+template<> struct SaxAction<rules::framename> {
+  template<typename Input, typename State>
+  static void apply(const Input& in, State& st) {
+    st.handler.start_frame(to_view(in));
+  }
+};
+template<> struct SaxAction<rules::endframe> {
+  template<typename Input, typename State>
+  static void apply(const Input&, State& st) {
+    st.handler.end_frame();
+  }
+};
+template<> struct SaxAction<rules::item_tag> {
+  template<typename Input, typename State>
+  static void apply(const Input& in, State& st) {
+    st.pair_tag = to_view(in);
+    st.skip_pair = !st.is_wanted(st.pair_tag);
+  }
+};
+template<> struct SaxAction<rules::item_value> {
+  template<typename Input, typename State>
+  static void apply(const Input& in, State& st) {
+    if (!st.skip_pair)
+      st.handler.pair(st.pair_tag, to_view(in));
+  }
+};
+template<> struct SaxAction<rules::missing_value> {
+  template<typename Input, typename State>
+  static void apply(const Input& in, State&) {
+    throw pegtl::parse_error("tag without value", in);
+  }
+};
+template<> struct SaxAction<rules::str_loop> {
+  template<typename Input, typename State>
+  static void apply(const Input&, State& st) {
+    st.row.clear();
+    st.column = 0;
+  }
+};
+template<> struct SaxAction<rules::loop_tag> {
+  template<typename Input, typename State>
+  static void apply(const Input& in, State& st) {
+    StrView tag = to_view(in);
+    if (st.row.empty()) {
+      // the category of the first tag decides
+      st.skip_loop = !st.is_wanted(tag);
+      if (!st.skip_loop)
+        st.handler.start_loop();
+    }
+    st.row.push_back(tag);
+    if (!st.skip_loop)
+      st.handler.loop_tag(tag);
+  }
+};
+template<> struct SaxAction<rules::loop_value> {
+  template<typename Input, typename State>
+  static void apply(const Input& in, State& st) {
+    if (st.skip_loop) {
+      if (++st.column == st.row.size())
+        st.column = 0;
+      return;
+    }
+    st.row[st.column] = to_view(in);
+    if (++st.column == st.row.size()) {
+      st.handler.loop_row(st.row.data(), st.row.size());
+      st.column = 0;
+    }
+  }
+};
+template<> struct SaxAction<rules::loop> {
+  template<typename Input, typename State>
+  static void apply(const Input& in, State& st) {
+    if (st.column != 0)
+      throw pegtl::parse_error("Wrong number of values in loop", in);
+    if (!st.skip_loop)
+      st.handler.end_loop();
+  }
+};
+
+// The input must be memory-based (memory_input, file_input), because
+// values are passed as views into the input. If categories is not empty,
+// only pairs and loops from the listed categories are reported.
+template<typename Input, typename Handler>
+void parse_sax(Input&& in, Handler& handler,
+               const std::vector<std::string>& categories={}) {
+  SaxState<Handler> state(handler, categories);
+  pegtl::parse<rules::file, SaxAction, Errors>(in, state);
+}
+
+template<typename Handler>
+void read_memory_sax(const char* data, size_t size, const char* name,
+                     Handler& handler,
+                     const std::vector<std::string>& categories={}) {
+  pegtl::memory_input<> in(data, size, name);
+  parse_sax(in, handler, categories);
+}
+
+// Like read(), but with SAX-style callbacks. Reading from stdin
+// or from a compressed file goes through a buffer.
+template<typename T, typename Handler>
+void read_sax(T&& input, Handler& handler,
+              const std::vector<std::string>& categories={}) {
+  if (input.is_stdin()) {
+    CharArray mem = read_stdin_into_buffer();
+    read_memory_sax(mem.data(), mem.size(), "stdin", handler, categories);
+  } else if (CharArray mem = input.uncompress_into_buffer()) {
+    read_memory_sax(mem.data(), mem.size(), input.path().c_str(),
+                    handler, categories);
+  } else {
+    GEMMI_CIF_FILE_INPUT(in, input.path());
+    parse_sax(in, handler, categories);
+  }
+}
+
 #if defined(_MSC_VER)
 #pragma warning(pop)
 #endif
@@ -0,0 +1,212 @@
+// Copyright 2026 Global Phasing Ltd.
+//
+// ViewDocument - a lighter alternative to cif::Document.
+// Tags and values are slices (StrView) of the file buffer, which is kept
+// in ViewDocument, so there is no allocation per value. Values that are
+// modified are copied into a per-document arena (copy-on-write).
+
+#ifndef GEMMI_CIFVIEW_HPP_
+#define GEMMI_CIFVIEW_HPP_
+
+#include <algorithm>  // for max
+#include <cstring>    // for memcpy
+#include <memory>     // for unique_ptr
+#include <string>
+#include <vector>
+#include "cif.hpp"    // for StrView, SaxHandler, parse_sax
+#include "cifdoc.hpp" // for Document, ItemType
+
+namespace gemmi {
+namespace cif {
+
+// Stores strings in large chunks that are never reallocated,
+// so the returned views stay valid for the lifetime of the arena.
+class StringArena {
+public:
+  StrView add(const char* str, size_t len) {
+    if (len > capacity_ - used_) {
+      capacity_ = std::max(len, chunk_size);
+      chunks_.emplace_back(new char[capacity_]);
+      used_ = 0;
+    }
+    char* dest = chunks_.back().get() + used_;
+    if (len != 0)
+      std::memcpy(dest, str, len);
+    used_ += len;
+    return StrView{dest, len};
+  }
+  StrView add(const std::string& str) { return add(str.data(), str.size()); }
+  void clear() { chunks_.clear(); used_ = capacity_ = 0; }
+
+  static const size_t chunk_size = 64 * 1024;
+private:
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  size_t used_ = 0;
+  size_t capacity_ = 0;
+};
+
+struct ViewItem {
+  ItemType type;                // Pair, Loop or Frame
+  std::vector<StrView> tags;    // one tag for Pair, frame name for Frame
+  std::vector<StrView> values;  // one value for Pair, all values for Loop
+  std::vector<ViewItem> items;  // only for Frame
+
+  size_t width() const { return tags.size(); }
+  size_t length() const { return values.size() / tags.size(); }
+  StrView val(size_t row, size_t col) const { return values[row * tags.size() + col]; }
+
+  int find_tag(const std::string& tag) const {
+    for (size_t i = 0; i != tags.size(); ++i)
+      if (tags[i] == tag)
+        return (int) i;
+    return -1;
+  }
+};
+
+struct ViewBlock {
+  StrView name;
+  std::vector<ViewItem> items;
+
+  const ViewItem* find_loop_item(const std::string& tag) const {
+    for (const ViewItem& item : items)
+      if (item.type == ItemType::Loop && item.find_tag(tag) != -1)
+        return &item;
+    return nullptr;
+  }
+  const StrView* find_value(const std::string& tag) const {
+    for (const ViewItem& item : items)
+      if (item.type == ItemType::Pair && item.tags[0] == tag)
+        return &item.values[0];
+    return nullptr;
+  }
+};
+
+struct ViewDocument {
+  std::string source;
+  std::vector<ViewBlock> blocks;
+  CharArray buffer;    // file content; empty if the caller owns the text
+  StringArena arena;   // values set after parsing
+
+  ViewDocument() = default;
+  ViewDocument(ViewDocument&&) = default;
+  ViewDocument& operator=(ViewDocument&&) = default;
+  ViewDocument(const ViewDocument&) = delete;
+  ViewDocument& operator=(const ViewDocument&) = delete;
+
+  // Copy-on-write: the new value is stored in the arena, the original
+  // text is not modified. slot is a tag or value from this document.
+  void set(StrView& slot, const std::string& value) { slot = arena.add(value); }
+
+  const ViewBlock& sole_block() const {
+    if (blocks.size() != 1)
+      fail("single data block expected, got " + std::to_string(blocks.size()));
+    return blocks[0];
+  }
+
+  // Creates a regular Document (with std::string values).
+  Document to_document() const {
+    Document doc;
+    doc.source = source;
+    doc.blocks.reserve(blocks.size());
+    for (const ViewBlock& vb : blocks) {
+      doc.blocks.emplace_back(vb.name.str());
+      copy_items(vb.items, doc.blocks.back().items);
+    }
+    return doc;
+  }
+
+private:
+  static void copy_items(const std::vector<ViewItem>& src, std::vector<Item>& dest) {
+    dest.reserve(src.size());
+    for (const ViewItem& vi : src) {
+      switch (vi.type) {
+        case ItemType::Pair:
+          dest.emplace_back(vi.tags[0].str(), vi.values[0].str());
+          break;
+        case ItemType::Loop: {
+          dest.emplace_back(LoopArg{});
+          Loop& loop = dest.back().loop;
+          loop.tags.reserve(vi.tags.size());
+          for (const StrView& tag : vi.tags)
+            loop.tags.emplace_back(tag.str());
+          loop.values.reserve(vi.values.size());
+          for (const StrView& value : vi.values)
+            loop.values.emplace_back(value.str());
+          break;
+        }
+        case ItemType::Frame:
+          dest.emplace_back(FrameArg{vi.tags[0].str()});
+          copy_items(vi.items, dest.back().frame.items);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+};
+
+// SAX handler that fills ViewDocument.
+struct ViewDocumentBuilder : SaxHandler {
+  ViewDocument& doc;
+  std::vector<ViewItem>* items = nullptr;
+
+  explicit ViewDocumentBuilder(ViewDocument& d) : doc(d) {}
+
+  void start_block(StrView name) {
+    // empty block name (bare data_) is stored as " ", as in Document
+    if (name.empty())
+      name = doc.arena.add(" ", 1);
+    doc.blocks.emplace_back();
+    doc.blocks.back().name = name;
+    items = &doc.blocks.back().items;
+  }
+  void start_frame(StrView name) {
+    items->emplace_back();
+    ViewItem& frame = items->back();
+    frame.type = ItemType::Frame;
+    frame.tags.push_back(name);
+    items = &frame.items;
+  }
+  void end_frame() { items = &doc.blocks.back().items; }
+  void pair(StrView tag, StrView value) {
+    items->emplace_back();
+    ViewItem& item = items->back();
+    item.type = ItemType::Pair;
+    item.tags.push_back(tag);
+    item.values.push_back(value);
+  }
+  void start_loop() {
+    items->emplace_back();
+    items->back().type = ItemType::Loop;
+  }
+  void loop_tag(StrView tag) { items->back().tags.push_back(tag); }
+  void loop_row(const StrView* values, size_t n) {
+    std::vector<StrView>& v = items->back().values;
+    v.insert(v.end(), values, values + n);
+  }
+};
+
+// The text must stay valid as long as the returned document is used.
+inline ViewDocument read_memory_view(const char* data, size_t size, const char* name,
+                                     const std::vector<std::string>& categories={}) {
+  ViewDocument doc;
+  doc.source = name;
+  ViewDocumentBuilder builder(doc);
+  read_memory_sax(data, size, name, builder, categories);
+  return doc;
+}
+
+// Reads (and uncompresses if needed) the file into ViewDocument::buffer.
+// If categories are given, other categories are not stored.
+template<typename T>
+ViewDocument read_view(T&& input, const std::vector<std::string>& categories={}) {
+  CharArray mem = read_into_buffer(input);
+  ViewDocument doc = read_memory_view(mem.data(), mem.size(),
+                                      input.path().c_str(), categories);
+  doc.buffer = std::move(mem);
+  return doc;
+}
+
+} // namespace cif
+} // namespace gemmi
+#endif
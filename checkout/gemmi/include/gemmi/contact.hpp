@@ -5,6 +5,9 @@
 #ifndef GEMMI_CONTACT_HPP_
 #define GEMMI_CONTACT_HPP_
 
+#include <exception>  // for exception_ptr
+#include <system_error>
+#include <thread>
 #include "model.hpp"
 #include "neighbor.hpp"
 #include "polyheur.hpp"  // for check_polymer_type, are_connected
@@ -22,6 +25,10 @@ struct ContactSearch {
   float min_occupancy = 0.f;
   double special_pos_cutoff_sq = 0.8 * 0.8;
   std::vector<float> radii;
+  // Threads used in find_contacts(). Each thread searches a contiguous
+  // range of residues and the results are joined in the model order,
+  // so the output is the same as with a single thread.
+  int num_threads = 1;
 
   ContactSearch(double radius) noexcept : search_radius(radius) {}
 
@@ -46,6 +53,8 @@ struct ContactSearch {
     double dist_sq;
   };
   std::vector<Result> find_contacts(NeighborSearch& ns) {
+    if (num_threads > 1)
+      return find_contacts_mt(ns);
     std::vector<Result> out;
     for_each_contact(ns, [&out](const CRA& cra1, const CRA& cra2,
                                 int image_idx, double dist_sq) {
@@ -53,6 +62,12 @@ struct ContactSearch {
     });
     return out;
   }
+  std::vector<Result> find_contacts_mt(NeighborSearch& ns);
+
+private:
+  template<typename Func>
+  void for_each_contact_in_residue(NeighborSearch& ns, int n_ch, int n_res,
+                                   PolymerType pt, const Func& func);
 };
 
 template<typename Func>
@@ -65,70 +80,152 @@ void ContactSearch::for_each_contact(NeighborSearch& ns, const Func& func) {
     PolymerType pt = PolymerType::Unknown;
     if (ignore == Ignore::AdjacentResidues)
       pt = check_polymer_type(chain.get_polymer());
-    for (int n_res = 0; n_res != (int) chain.residues.size(); ++n_res) {
-      Residue& res = chain.residues[n_res];
-      for (int n_atom = 0; n_atom != (int) res.atoms.size(); ++n_atom) {
-        Atom& atom = res.atoms[n_atom];
-        if (!ns.include_h && is_hydrogen(atom.element))
-          continue;
-        if (atom.occ < min_occupancy)
-          continue;
-        ns.for_each(atom.pos, atom.altloc, search_radius,
-                    [&](NeighborSearch::Mark& m, double dist_sq) {
-            // do not consider connections inside a residue
-            if (ignore != Ignore::Nothing && m.image_idx == 0 &&
-                m.chain_idx == n_ch && m.residue_idx == n_res)
-              return;
-            switch (ignore) {
-              case Ignore::Nothing:
-                break;
-              case Ignore::SameResidue:
-                if (m.image_idx == 0 && m.chain_idx == n_ch)
-                  if (m.residue_idx == n_res)
-                    return;
-                break;
-              case Ignore::AdjacentResidues:
-                if (m.image_idx == 0 && m.chain_idx == n_ch)
-                  if (m.residue_idx == n_res ||
-                      are_connected(res, chain.residues[m.residue_idx], pt) ||
-                      are_connected(chain.residues[m.residue_idx], res, pt))
-                    return;
-                break;
-              case Ignore::SameChain:
-                if (m.image_idx == 0 && m.chain_idx == n_ch)
-                  return;
-                break;
-              case Ignore::SameAsu:
-                if (m.image_idx == 0)
-                  return;
-                break;
-            }
-            // additionally, we may have per-element distances
-            if (!radii.empty()) {
-              double d = radii[atom.element.ordinal()] + radii[m.element.ordinal()];
-              if (d < 0 || dist_sq > d * d)
+    for (int n_res = 0; n_res != (int) chain.residues.size(); ++n_res)
+      for_each_contact_in_residue(ns, n_ch, n_res, pt, func);
+  }
+}
+
+template<typename Func>
+void ContactSearch::for_each_contact_in_residue(NeighborSearch& ns, int n_ch, int n_res,
+                                                PolymerType pt, const Func& func) {
+  Chain& chain = ns.model->chains[n_ch];
+  Residue& res = chain.residues[n_res];
+  for (int n_atom = 0; n_atom != (int) res.atoms.size(); ++n_atom) {
+    Atom& atom = res.atoms[n_atom];
+    if (!ns.include_h && is_hydrogen(atom.element))
+      continue;
+    if (atom.occ < min_occupancy)
+      continue;
+    ns.for_each(atom.pos, atom.altloc, search_radius,
+                [&](NeighborSearch::Mark& m, double dist_sq) {
+        // do not consider connections inside a residue
+        if (ignore != Ignore::Nothing && m.image_idx == 0 &&
+            m.chain_idx == n_ch && m.residue_idx == n_res)
+          return;
+        switch (ignore) {
+          case Ignore::Nothing:
+            break;
+          case Ignore::SameResidue:
+            if (m.image_idx == 0 && m.chain_idx == n_ch)
+              if (m.residue_idx == n_res)
                 return;
-            }
-            // avoid reporting connections twice (A-B and B-A)
-            if (!twice)
-              if (m.chain_idx < n_ch || (m.chain_idx == n_ch &&
-                    (m.residue_idx < n_res || (m.residue_idx == n_res &&
-                                               m.atom_idx < n_atom))))
+            break;
+          case Ignore::AdjacentResidues:
+            if (m.image_idx == 0 && m.chain_idx == n_ch)
+              if (m.residue_idx == n_res ||
+                  are_connected(res, chain.residues[m.residue_idx], pt) ||
+                  are_connected(chain.residues[m.residue_idx], res, pt))
                 return;
-            // atom can be linked with its image, but if the image
-            // is too close the atom is likely on special position.
-            if (m.chain_idx == n_ch && m.residue_idx == n_res &&
-                m.atom_idx == n_atom && dist_sq < special_pos_cutoff_sq)
+            break;
+          case Ignore::SameChain:
+            if (m.image_idx == 0 && m.chain_idx == n_ch)
               return;
-            CRA cra2 = m.to_cra(*ns.model);
-            // ignore atoms with occupancy below the specified value
-            if (cra2.atom->occ < min_occupancy)
+            break;
+          case Ignore::SameAsu:
+            if (m.image_idx == 0)
               return;
-            func(CRA{&chain, &res, &atom}, cra2, m.image_idx, dist_sq);
+            break;
+        }
+        // additionally, we may have per-element distances
+        if (!radii.empty()) {
+          double d = radii[atom.element.ordinal()] + radii[m.element.ordinal()];
+          if (d < 0 || dist_sq > d * d)
+            return;
+        }
+        // avoid reporting connections twice (A-B and B-A)
+        if (!twice)
+          if (m.chain_idx < n_ch || (m.chain_idx == n_ch &&
+                (m.residue_idx < n_res || (m.residue_idx == n_res &&
+                                           m.atom_idx < n_atom))))
+            return;
+        // atom can be linked with its image, but if the image
+        // is too close the atom is likely on special position.
+        if (m.chain_idx == n_ch && m.residue_idx == n_res &&
+            m.atom_idx == n_atom && dist_sq < special_pos_cutoff_sq)
+          return;
+        CRA cra2 = m.to_cra(*ns.model);
+        // ignore atoms with occupancy below the specified value
+        if (cra2.atom->occ < min_occupancy)
+          return;
+        func(CRA{&chain, &res, &atom}, cra2, m.image_idx, dist_sq);
+    });
+  }
+}
+
+inline std::vector<ContactSearch::Result> ContactSearch::find_contacts_mt(NeighborSearch& ns) {
+  if (!ns.model)
+    fail(ns.small_structure ? "ContactSearch does not work with SmallStructure"
+                            : "NeighborSearch not initialized");
+  Model& model = *ns.model;
+  // residues in the model order, split into ranges with similar atom counts
+  struct ResidueRef { int n_ch, n_res; PolymerType pt; };
+  std::vector<ResidueRef> residues;
+  size_t atom_count = 0;
+  for (int n_ch = 0; n_ch != (int) model.chains.size(); ++n_ch) {
+    const Chain& chain = model.chains[n_ch];
+    PolymerType pt = PolymerType::Unknown;
+    if (ignore == Ignore::AdjacentResidues)
+      pt = check_polymer_type(chain.get_polymer());
+    for (int n_res = 0; n_res != (int) chain.residues.size(); ++n_res) {
+      residues.push_back({n_ch, n_res, pt});
+      atom_count += chain.residues[n_res].atoms.size();
+    }
+  }
+  // one range per thread; more threads than cores would only add overhead
+  size_t max_threads = num_threads;
+  unsigned hw = std::thread::hardware_concurrency();
+  if (hw != 0 && max_threads > hw)
+    max_threads = hw;
+  int n = (int) std::min(residues.size(), max_threads);
+  if (n < 1)
+    return {};
+  std::vector<size_t> split(n + 1, residues.size());
+  split[0] = 0;
+  size_t atoms_so_far = 0;
+  for (size_t i = 0, t = 1; i != residues.size() && t < (size_t) n; ++i) {
+    atoms_so_far += model.chains[residues[i].n_ch].residues[residues[i].n_res].atoms.size();
+    if (atoms_so_far * n >= atom_count * t)
+      split[t++] = i + 1;
+  }
+  std::vector<std::vector<Result>> parts(n);
+  std::vector<std::exception_ptr> errors(n);
+  auto run_range = [&](int t) {
+    try {
+      std::vector<Result>& out = parts[t];
+      for (size_t i = split[t]; i < split[t + 1]; ++i)
+        for_each_contact_in_residue(ns, residues[i].n_ch, residues[i].n_res, residues[i].pt,
+                                    [&out](const CRA& cra1, const CRA& cra2,
+                                           int image_idx, double dist_sq) {
+            out.push_back({cra1, cra2, image_idx, dist_sq});
         });
-      }
+    } catch (...) {
+      errors[t] = std::current_exception();
     }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(n);
+  int started = 0;
+  try {
+    for (; started < n; ++started)
+      threads.emplace_back(run_range, started);
+  } catch (const std::system_error&) {
+    // a thread could not be started; the remaining ranges run below
   }
+  for (int t = started; t < n; ++t)
+    run_range(t);
+  for (std::thread& thread : threads)
+    thread.join();
+  for (const std::exception_ptr& error : errors)
+    if (error)
+      std::rethrow_exception(error);
+  size_t total = 0;
+  for (const std::vector<Result>& part : parts)
+    total += part.size();
+  std::vector<Result> out;
+  out.reserve(total);
+  for (const std::vector<Result>& part : parts)
+    out.insert(out.end(), part.begin(), part.end());
+  return out;
 }
 
 } // namespace gemmi
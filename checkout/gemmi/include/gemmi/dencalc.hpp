@@ -6,6 +6,8 @@
 #define GEMMI_DENCALC_HPP_
 
 #include <cassert>
+#include <climits>      // for INT_MAX
+#include <thread>
 #include "addends.hpp"  // for Addends
 #include "formfact.hpp" // for ExpSum
 #include "grid.hpp"     // for Grid
@@ -100,6 +102,10 @@ struct DensityCalculator {
   double rate = 1.5;
   double blur = 0.;
   float cutoff = 1e-5f;
+  // Threads used in add_model_density_to_grid(). Each thread fills
+  // a separate range of grid sections (along w) and the atoms are added
+  // in the same order, so the result doesn't depend on this number.
+  int num_threads = 1;
 #if GEMMI_COUNT_DC
   size_t atoms_added = 0;
   size_t density_computations = 0;
@@ -117,9 +123,11 @@ struct DensityCalculator {
   }
 
   // pre: check if Table::has(atom.element)
-  void add_atom_density_to_grid(const Atom& atom) {
+  // w_begin and w_end limit the range of grid sections that is modified.
+  void add_atom_density_to_grid(const Atom& atom, int w_begin=0, int w_end=INT_MAX) {
     Element el = atom.element;
-    do_add_atom_density_to_grid(atom, Table::get(el, atom.charge), addends.get(el));
+    do_add_atom_density_to_grid(atom, Table::get(el, atom.charge), addends.get(el),
+                                w_begin, w_end);
   }
 
   // Parameter c is a constant factor and has the same meaning as either addend
@@ -136,8 +144,46 @@ struct DensityCalculator {
     return determine_cutoff_radius(x1, precal, (CReal)cutoff);
   }
 
+  // Half-width (in grid sections along w) of the box of points
+  // that add_atom_density_to_grid() uses for this atom.
+  int atom_section_halfwidth(const Atom& atom) const {
+    Element el = atom.element;
+    auto coef = Table::get(el, atom.charge);
+    CReal b;
+    if (!atom.aniso.nonzero()) {
+      b = static_cast<CReal>(atom.b_iso + blur);
+    } else {
+      auto aniso_b = atom.aniso.scaled(CReal(u_to_b())).added_kI(CReal(blur));
+      b = std::max(std::max(aniso_b.u11, aniso_b.u22), aniso_b.u33);
+    }
+    auto precal = coef.precalculate_density_iso(b, addends.get(el));
+    double radius = estimate_radius(precal, b);
+    int dw = (int) std::ceil(radius / grid.spacing[2]);
+    return std::min(dw, grid.nw - 1);
+  }
+
+  // Adds density to a run of n consecutive grid points; the squared
+  // distance of ptr[i] from the atom is d2_0 + sq(x0 - i * dx).
+  // Distances are evaluated in chunks, so that precal can use SIMD.
+  template<typename Precal>
+  static void add_density_to_row(GReal* ptr, int n, double d2_0, double x0, double dx,
+                                 const Precal& precal, float occ) {
+    constexpr int chunk = 64;
+    CReal r2[chunk];
+    CReal val[chunk];
+    for (int i0 = 0; i0 < n; i0 += chunk) {
+      int m = std::min(n - i0, chunk);
+      for (int i = 0; i < m; ++i)
+        r2[i] = CReal(d2_0 + sq(x0 - (i0 + i) * dx));
+      precal.calculate_row(r2, val, m);
+      for (int i = 0; i < m; ++i)
+        ptr[i0 + i] += GReal(occ * val[i]);
+    }
+  }
+
   template<typename Coef>
-  void do_add_atom_density_to_grid(const Atom& atom, const Coef& coef, float addend) {
+  void do_add_atom_density_to_grid(const Atom& atom, const Coef& coef, float addend,
+                                   int w_begin=0, int w_end=INT_MAX) {
 #if GEMMI_COUNT_DC
     ++atoms_added;
 #endif
@@ -147,12 +193,19 @@ struct DensityCalculator {
       CReal b = static_cast<CReal>(atom.b_iso + blur);
       auto precal = coef.precalculate_density_iso(b, addend);
       CReal radius = estimate_radius(precal, b);
-      grid.template use_points_around<true>(fpos, radius, [&](GReal& point, double r2) {
-          point += GReal(atom.occ * precal.calculate((CReal)r2));
+      int du = (int) std::ceil(radius / grid.spacing[0]);
+      int dv = (int) std::ceil(radius / grid.spacing[1]);
+      int dw = (int) std::ceil(radius / grid.spacing[2]);
+      grid.template check_size_for_points_in_box<true>(du, dv, dw, false);
+      grid.do_use_rows_in_box(
+          fpos, du, dv, dw,
+          [&](GReal* ptr, int n, double d2_0, double x0, double dx) {
+            add_density_to_row(ptr, n, d2_0, x0, dx, precal, atom.occ);
 #if GEMMI_COUNT_DC
-          ++density_computations;
+            density_computations += n;
 #endif
-      }, /*fail_on_too_large_radius=*/false);
+          },
+          radius, w_begin, w_end);
     } else {
       // anisotropic
       auto aniso_b = atom.aniso.scaled(CReal(u_to_b())).added_kI(CReal(blur));
@@ -164,7 +217,8 @@ struct DensityCalculator {
       int du = (int) std::ceil(radius / grid.spacing[0]);
       int dv = (int) std::ceil(radius / grid.spacing[1]);
       int dw = (int) std::ceil(radius / grid.spacing[2]);
-      grid.template use_points_in_box<true>(
+      grid.template check_size_for_points_in_box<true>(du, dv, dw, false);
+      grid.template do_use_points_in_box<true>(
           fpos, du, dv, dw,
           [&](GReal& point, double, const Position& delta, int, int, int) {
             point += GReal(atom.occ * precal.calculate(delta));
@@ -172,7 +226,7 @@ struct DensityCalculator {
             ++density_computations;
 #endif
           },
-          false, radius);
+          radius, w_begin, w_end);
     }
   }
 
@@ -190,12 +244,55 @@ struct DensityCalculator {
 
   void add_model_density_to_grid(const Model& model) {
     grid.check_not_empty();
+#if !GEMMI_COUNT_DC  // counters are not thread-safe
+    if (num_threads > 1 && grid.nw > 1) {
+      add_model_density_to_grid_mt(model);
+      return;
+    }
+#endif
     for (const Chain& chain : model.chains)
       for (const Residue& res : chain.residues)
         for (const Atom& atom : res.atoms)
           add_atom_density_to_grid(atom);
   }
 
+  void add_model_density_to_grid_mt(const Model& model) {
+    std::vector<const Atom*> atoms;
+    for (const Chain& chain : model.chains)
+      for (const Residue& res : chain.residues)
+        for (const Atom& atom : res.atoms)
+          atoms.push_back(&atom);
+    int n = std::min(num_threads, grid.nw);
+    std::vector<std::thread> threads;
+    threads.reserve(n);
+    // sections spanned by each atom: w0-dw ... w0+dw
+    std::vector<std::pair<int,int>> spans(atoms.size());
+    for (int t = 0; t < n; ++t)
+      threads.emplace_back([&, t]() {
+        for (size_t i = atoms.size() * t / n; i < atoms.size() * (t + 1) / n; ++i) {
+          double z = grid.unit_cell.fractionalize(atoms[i]->pos).z;
+          spans[i].first = iround(z * grid.nw);
+          spans[i].second = atom_section_halfwidth(*atoms[i]);
+        }
+      });
+    for (std::thread& thread : threads)
+      thread.join();
+    threads.clear();
+    for (int t = 0; t < n; ++t)
+      threads.emplace_back([&, t]() {
+        int w_begin = grid.nw * t / n;
+        int w_end = grid.nw * (t + 1) / n;
+        for (size_t i = 0; i != atoms.size(); ++i) {
+          int lo = modulo(spans[i].first - spans[i].second, grid.nw);
+          int hi = lo + 2 * spans[i].second;
+          if ((lo < w_end && hi >= w_begin) || hi - grid.nw >= w_begin)
+            add_atom_density_to_grid(*atoms[i], w_begin, w_end);
+        }
+      });
+    for (std::thread& thread : threads)
+      thread.join();
+  }
+
   void put_model_density_on_grid(const Model& model) {
     initialize_grid();
     add_model_density_to_grid(model);
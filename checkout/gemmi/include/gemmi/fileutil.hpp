@@ -10,12 +10,19 @@
 #include <cstring>   // strlen
 #include <initializer_list>
 #include <memory>    // for unique_ptr
+#include <utility>   // for swap
 #include "fail.hpp"  // for sys_fail
 #include "input.hpp"  // for CharArray
 
 #if defined(_WIN32) && !defined(GEMMI_USE_FOPEN)
 #include "utf.hpp"
 #endif
+#if !defined(_WIN32)
+#include <fcntl.h>     // for open
+#include <sys/mman.h>  // for mmap, munmap
+#include <sys/stat.h>  // for fstat
+#include <unistd.h>    // for close
+#endif
 
 namespace gemmi {
 
@@ -118,6 +125,74 @@ inline CharArray read_stdin_into_buffer() {
   return buffer;
 }
 
+// Read-only memory mapping of a whole file. The mapped pages are shared
+// with the page cache, so they don't add to the anonymous memory (RSS)
+// of the process. On Windows the file is read into a buffer instead.
+class MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string& path) { open(path); }
+  MappedFile(MappedFile&& o) noexcept { *this = std::move(o); }
+  MappedFile& operator=(MappedFile&& o) noexcept {
+    std::swap(data_, o.data_);
+    std::swap(size_, o.size_);
+    std::swap(buffer_, o.buffer_);
+    return *this;
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() { close(); }
+
+  void open(const std::string& path) {
+    close();
+#if defined(_WIN32)
+    buffer_ = read_file_into_buffer(path);
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      sys_fail("Failed to open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      sys_fail(path + ": fstat failed");
+    }
+    size_ = (size_t) st.st_size;
+    if (size_ != 0) {
+      void* ptr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptr == MAP_FAILED) {
+        ::close(fd);
+        size_ = 0;
+        sys_fail(path + ": mmap failed");
+      }
+      data_ = static_cast<const char*>(ptr);
+    }
+    ::close(fd);
+#endif
+  }
+
+  void close() {
+#if !defined(_WIN32)
+    if (data_)
+      ::munmap(const_cast<char*>(data_), size_);
+#endif
+    buffer_ = CharArray();
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  explicit operator bool() const { return data_ != nullptr; }
+  MemoryStream stream() const { return MemoryStream(data_, size_); }
+
+private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  CharArray buffer_;  // used only on Windows
+};
+
 template<typename T>
 inline CharArray read_into_buffer(T&& input) {
   if (input.is_stdin())
@@ -11,6 +11,9 @@
 #include <limits>    // for numeric_limits
 #include <utility>   // for pair
 #include "math.hpp"  // for pi()
+#if defined(__AVX2__) || defined(__AVX512F__)
+# include <immintrin.h>
+#endif
 
 namespace gemmi {
 
@@ -33,6 +36,44 @@ inline float unsafe_expapprox(float x) {
           (-2.190619930e-3f + b * 1.3555747234e-2f))));
 }
 
+// Vectorized versions of unsafe_expapprox(), the same restrictions apply.
+#if defined(__AVX2__)
+inline __m256 unsafe_expapprox_avx2(__m256 x) {
+  __m256 val = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(12102203.1615614f), x),
+                             _mm256_set1_ps(1065353216.f));
+  __m256i vali = _mm256_cvttps_epi32(val);
+  __m256i xu1 = _mm256_and_si256(vali, _mm256_set1_epi32(0x7F800000));
+  __m256i xu2 = _mm256_or_si256(_mm256_and_si256(vali, _mm256_set1_epi32(0x7FFFFF)),
+                                _mm256_set1_epi32(0x3F800000));
+  __m256 a = _mm256_castsi256_ps(xu1);
+  __m256 b = _mm256_castsi256_ps(xu2);
+  __m256 p = _mm256_add_ps(_mm256_set1_ps(-2.190619930e-3f),
+                           _mm256_mul_ps(b, _mm256_set1_ps(1.3555747234e-2f)));
+  p = _mm256_add_ps(_mm256_set1_ps(0.166617139f), _mm256_mul_ps(b, p));
+  p = _mm256_add_ps(_mm256_set1_ps(0.312146713f), _mm256_mul_ps(b, p));
+  p = _mm256_add_ps(_mm256_set1_ps(0.509871020f), _mm256_mul_ps(b, p));
+  return _mm256_mul_ps(a, p);
+}
+#endif
+#if defined(__AVX512F__)
+inline __m512 unsafe_expapprox_avx512(__m512 x) {
+  __m512 val = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(12102203.1615614f), x),
+                             _mm512_set1_ps(1065353216.f));
+  __m512i vali = _mm512_cvttps_epi32(val);
+  __m512i xu1 = _mm512_and_si512(vali, _mm512_set1_epi32(0x7F800000));
+  __m512i xu2 = _mm512_or_si512(_mm512_and_si512(vali, _mm512_set1_epi32(0x7FFFFF)),
+                                _mm512_set1_epi32(0x3F800000));
+  __m512 a = _mm512_castsi512_ps(xu1);
+  __m512 b = _mm512_castsi512_ps(xu2);
+  __m512 p = _mm512_add_ps(_mm512_set1_ps(-2.190619930e-3f),
+                           _mm512_mul_ps(b, _mm512_set1_ps(1.3555747234e-2f)));
+  p = _mm512_add_ps(_mm512_set1_ps(0.166617139f), _mm512_mul_ps(b, p));
+  p = _mm512_add_ps(_mm512_set1_ps(0.312146713f), _mm512_mul_ps(b, p));
+  p = _mm512_add_ps(_mm512_set1_ps(0.509871020f), _mm512_mul_ps(b, p));
+  return _mm512_mul_ps(a, p);
+}
+#endif
+
 // precalculated density of an isotropic atom
 template<int N, typename Real>
 struct ExpSum {
@@ -45,6 +86,12 @@ struct ExpSum {
     return density;
   }
 
+  // out[i] = calculate(r2[i]) for i < n
+  void calculate_row(const Real* r2, Real* out, int n) const {
+    for (int i = 0; i < n; ++i)
+      out[i] = calculate(r2[i]);
+  }
+
   std::pair<Real,Real> calculate_with_derivative(Real r) const {
     Real density = 0;
     Real derivative = 0;
@@ -70,6 +117,39 @@ struct ExpSum<N, float> {
     return density;
   }
 
+  // out[i] = calculate(r2[i]) for i < n, using SIMD if available
+  void calculate_row(const float* r2, float* out, int n) const {
+    int i = 0;
+#if defined(__AVX512F__)
+    for (; i + 16 <= n; i += 16) {
+      __m512 x = _mm512_loadu_ps(r2 + i);
+      __m512 density = _mm512_setzero_ps();
+      for (int j = 0; j < N; ++j) {
+        __m512 t = _mm512_max_ps(_mm512_mul_ps(_mm512_set1_ps(b[j]), x),
+                                 _mm512_set1_ps(-88.f));
+        density = _mm512_add_ps(density, _mm512_mul_ps(_mm512_set1_ps(a[j]),
+                                                       unsafe_expapprox_avx512(t)));
+      }
+      _mm512_storeu_ps(out + i, density);
+    }
+#endif
+#if defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+      __m256 x = _mm256_loadu_ps(r2 + i);
+      __m256 density = _mm256_setzero_ps();
+      for (int j = 0; j < N; ++j) {
+        __m256 t = _mm256_max_ps(_mm256_mul_ps(_mm256_set1_ps(b[j]), x),
+                                 _mm256_set1_ps(-88.f));
+        density = _mm256_add_ps(density, _mm256_mul_ps(_mm256_set1_ps(a[j]),
+                                                       unsafe_expapprox_avx2(t)));
+      }
+      _mm256_storeu_ps(out + i, density);
+    }
+#endif
+    for (; i < n; ++i)
+      out[i] = calculate(r2[i]);
+  }
+
   std::pair<float,float> calculate_with_derivative(float r) const {
     float density = 0;
     float derivative = 0;
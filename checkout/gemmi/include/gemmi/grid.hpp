@@ -6,6 +6,7 @@
 #define GEMMI_GRID_HPP_
 
 #include <cassert>
+#include <climits>    // for INT_MAX
 #include <cstddef>    // for ptrdiff_t
 #include <complex>
 #include <algorithm>  // for fill
@@ -612,9 +613,11 @@ struct Grid : GridBase<T> {
     }
   }
 
+  // Only sections with (wrapped) index w_begin <= w < w_end are visited;
+  // this allows threads to work on separate sections of the grid.
   template <bool UsePbc, typename Func>
   void do_use_points_in_box(const Fractional& fctr, int du, int dv, int dw, Func&& func,
-                            double radius=INFINITY) {
+                            double radius=INFINITY, int w_begin=0, int w_end=INT_MAX) {
     double max_dist_sq = radius * radius;
     const Fractional nctr(fctr.x * nu, fctr.y * nv, fctr.z * nw);
     int u0 = iround(nctr.x);
@@ -640,6 +643,8 @@ struct Grid : GridBase<T> {
     auto wrap = [](int& q, int nq) { if (UsePbc && q == nq) q = 0; };
     Fractional fdelta(nctr.x - u_lo, 0, 0);
     for (int w = w_lo, w_ = w_0; w <= w_hi; ++w, wrap(++w_, nw)) {
+      if (w_ < w_begin || w_ >= w_end)
+        continue;
       fdelta.z = nctr.z - w;
       for (int v = v_lo, v_ = v_0; v <= v_hi; ++v, wrap(++v_, nv)) {
         fdelta.y = nctr.y - v;
@@ -667,6 +672,50 @@ struct Grid : GridBase<T> {
     }
   }
 
+  // Variant of do_use_points_in_box<true>() for functions that process
+  // a run of points at once. For each run of points within radius
+  // that is contiguous in memory it calls func(ptr, n, dist_sq0, x0, dx);
+  // the squared distance of ptr[i] is dist_sq0 + sq(x0 - i * dx).
+  // radius must be finite.
+  template <typename Func>
+  void do_use_rows_in_box(const Fractional& fctr, int du, int dv, int dw, Func&& func,
+                          double radius, int w_begin=0, int w_end=INT_MAX) {
+    double max_dist_sq = radius * radius;
+    const Fractional nctr(fctr.x * nu, fctr.y * nv, fctr.z * nw);
+    int u_lo = iround(nctr.x) - du;
+    int v_lo = iround(nctr.y) - dv;
+    int v_hi = iround(nctr.y) + dv;
+    int w_lo = iround(nctr.z) - dw;
+    int w_hi = iround(nctr.z) + dw;
+    int v_0 = modulo(v_lo, nv);
+    int w_0 = modulo(w_lo, nw);
+    auto wrap = [](int& q, int nq) { if (q == nq) q = 0; };
+    double dx = orth_n.a11;
+    Fractional fdelta(nctr.x - u_lo, 0, 0);
+    for (int w = w_lo, w_ = w_0; w <= w_hi; ++w, wrap(++w_, nw)) {
+      if (w_ < w_begin || w_ >= w_end)
+        continue;
+      fdelta.z = nctr.z - w;
+      for (int v = v_lo, v_ = v_0; v <= v_hi; ++v, wrap(++v_, nv)) {
+        fdelta.y = nctr.y - v;
+        Position delta(orth_n.multiply(fdelta));
+        double dist_sq0 = sq(delta.y) + sq(delta.z);
+        if (dist_sq0 > max_dist_sq)
+          continue;
+        // points k = u - u_lo for which sq(delta.x - k * dx) <= max_dist_sq - dist_sq0
+        double s = std::sqrt(max_dist_sq - dist_sq0);
+        int k_lo = std::max((int) std::ceil((delta.x - s) / dx), 0);
+        int k_hi = std::min((int) std::floor((delta.x + s) / dx), 2 * du);
+        for (int k = k_lo; k <= k_hi; ) {
+          int u_ = modulo(u_lo + k, nu);
+          int n = std::min(k_hi - k + 1, nu - u_);
+          func(&data[this->index_q(u_, v_, w_)], n, dist_sq0, delta.x - k * dx, dx);
+          k += n;
+        }
+      }
+    }
+  }
+
   template <bool UsePbc, typename Func>
   void use_points_in_box(const Fractional& fctr, int du, int dv, int dw,
                          Func&& func, bool fail_on_too_large_radius=true,
@@ -4,10 +4,18 @@
 
 #ifndef GEMMI_GZ_HPP_
 #define GEMMI_GZ_HPP_
+#include <algorithm>    // min, max
 #include <cassert>
 #include <cstdio>       // fseek, ftell, fread
 #include <climits>      // INT_MAX
+#include <cstring>      // memcpy
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 #include <zlib.h>
 #include "fail.hpp"     // fail, sys_fail
 #include "fileutil.hpp" // file_open
@@ -62,6 +70,213 @@ inline size_t big_gzread(gzFile file, void* buf, size_t len) {
   return read_bytes;
 }
 
+// Uncompresses a gzip file (also one with multiple members) in chunks.
+// The uncompressed size doesn't need to be known.
+// With num_threads > 1 a background thread reads the compressed file ahead,
+// so reading and inflating overlap; otherwise (or if the thread cannot be
+// started) chunks are read when needed.
+// It can be used as a reader for pegtl::buffer_input (see cif::read_reader).
+class GzStreamReader {
+public:
+  explicit GzStreamReader(const std::string& path, size_t chunk_size=1024*1024,
+                          int num_threads=1)
+      : path_(path), file_(file_open(path.c_str(), "rb")),
+        chunk_size_(chunk_size), out_(64*1024) {
+    std::memset(&strm_, 0, sizeof(strm_));
+    // 15+32: gzip or zlib header, detected automatically
+    if (inflateInit2(&strm_, 15 + 32) != Z_OK)
+      fail("inflateInit2 failed");
+    if (num_threads > 1) {
+      try {
+        reader_ = std::thread([this]() { read_ahead(); });
+      } catch (const std::system_error&) {
+        // no threads (e.g. WebAssembly without pthreads); read inline
+      }
+    }
+  }
+  ~GzStreamReader() {
+    if (reader_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      cond_.notify_all();
+      reader_.join();
+    }
+    inflateEnd(&strm_);
+  }
+  GzStreamReader(const GzStreamReader&) = delete;
+  GzStreamReader& operator=(const GzStreamReader&) = delete;
+
+  // copies up to len uncompressed bytes into buf, returns 0 at the end
+  size_t read(char* buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+      if (out_pos_ == out_end_ && !fill_output())
+        break;
+      size_t k = std::min(len - n, out_end_ - out_pos_);
+      std::memcpy(buf + n, out_.data() + out_pos_, k);
+      out_pos_ += k;
+      n += k;
+    }
+    return n;
+  }
+  size_t operator()(char* buf, size_t len) { return read(buf, len); }
+
+private:
+  std::string path_;
+  fileptr_t file_;
+  size_t chunk_size_;
+  z_stream strm_;
+  std::vector<unsigned char> in_;       // chunk being inflated
+  std::vector<unsigned char> out_;      // uncompressed data not returned yet
+  size_t out_pos_ = 0;
+  size_t out_end_ = 0;
+  bool in_member_ = false;
+  bool finished_ = false;
+  int members_ = 0;
+  // shared with the reading thread, if there is one
+  std::thread reader_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::vector<unsigned char>> chunks_;
+  bool eof_ = false;
+  bool read_error_ = false;
+  bool stop_ = false;
+
+  void read_ahead() {
+    for (;;) {
+      std::vector<unsigned char> chunk(chunk_size_);
+      size_t n = std::fread(chunk.data(), 1, chunk.size(), file_.get());
+      chunk.resize(n);
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (n != 0)
+        chunks_.push_back(std::move(chunk));
+      if (n < chunk_size_) {
+        eof_ = true;
+        read_error_ = std::ferror(file_.get()) != 0;
+      }
+      cond_.notify_all();
+      if (eof_)
+        return;
+      // keep at most two chunks ahead
+      cond_.wait(lock, [this]() { return stop_ || chunks_.size() < 2; });
+      if (stop_)
+        return;
+    }
+  }
+
+  bool next_chunk() {
+    if (!reader_.joinable()) {
+      in_.resize(chunk_size_);
+      size_t n = std::fread(in_.data(), 1, in_.size(), file_.get());
+      if (n < chunk_size_ && std::ferror(file_.get()))
+        sys_fail("failed to read " + path_);
+      if (n == 0)
+        return false;
+      strm_.next_in = in_.data();
+      strm_.avail_in = (uInt) n;
+      return true;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return !chunks_.empty() || eof_; });
+    if (read_error_)
+      sys_fail("failed to read " + path_);
+    if (chunks_.empty())
+      return false;
+    in_.swap(chunks_.front());
+    chunks_.pop_front();
+    cond_.notify_all();
+    strm_.next_in = in_.data();
+    strm_.avail_in = (uInt) in_.size();
+    return true;
+  }
+
+  bool fill_output() {
+    out_pos_ = out_end_ = 0;
+    while (out_end_ == 0 && !finished_) {
+      if (strm_.avail_in == 0 && !next_chunk()) {
+        if (in_member_)
+          fail("Unexpected end of gzip file: " + path_);
+        finished_ = true;
+        break;
+      }
+      if (!in_member_) {
+        // like gzread(), ignore trailing data that is not a gzip member
+        if (members_ != 0 && strm_.next_in[0] != 0x1f) {
+          finished_ = true;
+          break;
+        }
+        if (members_ != 0)
+          inflateReset(&strm_);
+        in_member_ = true;
+        ++members_;
+      }
+      strm_.next_out = out_.data();
+      strm_.avail_out = (uInt) out_.size();
+      int ret = inflate(&strm_, Z_NO_FLUSH);
+      out_end_ = out_.size() - strm_.avail_out;
+      if (ret == Z_STREAM_END)
+        in_member_ = false;
+      else if (ret != Z_OK && ret != Z_BUF_ERROR)
+        fail("Error reading " + path_ + ": " + (strm_.msg ? strm_.msg : "inflate failed"));
+    }
+    return out_end_ != 0;
+  }
+};
+
+// BGZF (blocked gzip, as used by bgzip and htslib) consists of members
+// that store their compressed size in the header, so they can be located
+// without inflating and uncompressed independently.
+struct GzBlock {
+  size_t offset;  // position in the compressed data
+  size_t size;    // compressed size, including header and footer
+  size_t isize;   // uncompressed size
+};
+
+inline bool is_bgzf_header(const unsigned char* p, size_t n) {
+  return n >= 18 && p[0] == 0x1f && p[1] == 0x8b && p[2] == 8 && (p[3] & 4) &&
+         p[10] == 6 && p[11] == 0 && p[12] == 'B' && p[13] == 'C' &&
+         p[14] == 2 && p[15] == 0;
+}
+
+// returns false if the data is not entirely made of BGZF blocks
+inline bool find_bgzf_blocks(const unsigned char* data, size_t size,
+                             std::vector<GzBlock>& blocks) {
+  blocks.clear();
+  size_t pos = 0;
+  while (pos != size) {
+    const unsigned char* p = data + pos;
+    if (!is_bgzf_header(p, size - pos))
+      return false;
+    size_t block_size = (p[16] | (p[17] << 8)) + 1;
+    if (block_size < 26 || block_size > size - pos)
+      return false;
+    const unsigned char* end = p + block_size;
+    size_t isize = end[-4] | (end[-3] << 8) | (end[-2] << 16) | ((size_t)end[-1] << 24);
+    blocks.push_back({pos, block_size, isize});
+    pos += block_size;
+  }
+  return !blocks.empty();
+}
+
+// uncompresses one gzip member into exactly out_size bytes
+inline bool inflate_gzip_block(const unsigned char* in, size_t in_size,
+                               char* out, size_t out_size) {
+  z_stream strm;
+  std::memset(&strm, 0, sizeof(strm));
+  if (inflateInit2(&strm, 15 + 16) != Z_OK)
+    return false;
+  strm.next_in = const_cast<unsigned char*>(in);
+  strm.avail_in = (uInt) in_size;
+  strm.next_out = (unsigned char*) out;
+  strm.avail_out = (uInt) out_size;
+  int ret = inflate(&strm, Z_FINISH);
+  bool ok = ret == Z_STREAM_END && strm.avail_out == 0;
+  inflateEnd(&strm);
+  return ok;
+}
+
 class MaybeGzipped : public BasicInput {
 public:
   struct GzStream {
@@ -71,6 +286,11 @@ public:
     bool read(void* buf, size_t len) { return big_gzread(f, buf, len) == len; }
   };
 
+  // Threads used in uncompress_into_buffer() for BGZF files, which are
+  // made of independent blocks. Other gzip files are inflated by one thread
+  // (with num_threads > 1, another thread reads the file ahead).
+  int num_threads = 1;
+
   explicit MaybeGzipped(const std::string& path)
     : BasicInput(path), file_(nullptr) {}
   ~MaybeGzipped() {
@@ -105,6 +325,8 @@ public:
   CharArray uncompress_into_buffer(size_t limit=0) {
     if (!is_compressed())
       return BasicInput::uncompress_into_buffer();
+    if (limit == 0 && has_gzip_magic())
+      return uncompress_whole();
     size_t size = (limit == 0 ? estimate_uncompressed_size(path()) : limit);
     open();
     if (size > 3221225471)
@@ -145,6 +367,83 @@ public:
 private:
   gzFile file_;
 
+  bool has_gzip_magic() const {
+    fileptr_t f = file_open(path().c_str(), "rb");
+    unsigned char magic[2];
+    return std::fread(magic, 1, 2, f.get()) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+  }
+
+  // doesn't depend on the size in the gzip footer, so it works above 4 GiB
+  CharArray uncompress_whole() {
+    {
+      fileptr_t f = file_open(path().c_str(), "rb");
+      unsigned char header[18];
+      size_t n = std::fread(header, 1, sizeof(header), f.get());
+      if (is_bgzf_header(header, n)) {
+        CharArray mem;
+        if (uncompress_bgzf(mem))
+          return mem;
+      }
+    }
+    GzStreamReader reader(path(), 1024*1024, num_threads);
+    fileptr_t f = file_open(path().c_str(), "rb");
+    size_t gz_size = file_size(f.get(), path());
+    f.reset();
+    CharArray mem(std::max(gz_size * 4, (size_t) 64*1024));
+    size_t n = 0;
+    for (;;) {
+      n += reader.read(mem.data() + n, mem.size() - n);
+      if (n != mem.size())
+        break;
+      mem.resize(2 * mem.size());
+    }
+    mem.set_size(n);
+    return mem;
+  }
+
+  // returns false if the file is not all BGZF blocks
+  bool uncompress_bgzf(CharArray& mem) {
+    CharArray gz = read_file_into_buffer(path());
+    const unsigned char* data = (const unsigned char*) gz.data();
+    std::vector<GzBlock> blocks;
+    if (!find_bgzf_blocks(data, gz.size(), blocks))
+      return false;
+    std::vector<size_t> start(blocks.size() + 1, 0);
+    for (size_t i = 0; i != blocks.size(); ++i)
+      start[i+1] = start[i] + blocks[i].isize;
+    mem = CharArray(std::max(start.back(), (size_t) 1));
+    mem.set_size(start.back());
+    // contiguous ranges of blocks, one per thread
+    int n = (int) std::min(blocks.size(), (size_t) std::max(num_threads, 1));
+    std::vector<char> ok(n, 1);
+    auto work = [&](int t) {
+      for (size_t i = blocks.size() * t / n; i < blocks.size() * (t + 1) / n; ++i)
+        if (!inflate_gzip_block(data + blocks[i].offset, blocks[i].size,
+                                mem.data() + start[i], blocks[i].isize)) {
+          ok[t] = 0;
+          return;
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(n);
+    int started = 1;
+    try {
+      for (; started < n; ++started)
+        threads.emplace_back(work, started);
+    } catch (const std::system_error&) {
+      // a thread could not be started; the remaining ranges are inflated here
+    }
+    work(0);
+    for (int t = started; t < n; ++t)
+      work(t);
+    for (std::thread& thread : threads)
+      thread.join();
+    for (char t_ok : ok)
+      if (!t_ok)
+        fail("Error reading " + path() + ": corrupted BGZF block");
+    return true;
+  }
+
   void open() {
     file_ = gzopen(path().c_str(), "rb");
     if (!file_)
@@ -272,9 +272,12 @@ struct Intensities {
     if (!spacegroup)
       fail("unknown space group");
     wavelength = mtz.dataset(col.dataset_id).wavelength;
+    const size_t cs = mtz.column_step();
     for (size_t i = 0; i < mtz.data.size(); i += mtz.columns.size()) {
-      short isign = ((int)mtz.data[i + 3] % 2 == 0 ? -1 : 1);
-      add_if_valid(mtz.get_hkl(i), isign, mtz.data[i + value_idx], mtz.data[i + sigma_idx]);
+      size_t n = i / mtz.columns.size() * mtz.row_step();
+      short isign = ((int)mtz.data[n + 3 * cs] % 2 == 0 ? -1 : 1);
+      add_if_valid(mtz.get_hkl(i), isign, mtz.data[n + value_idx * cs],
+                   mtz.data[n + sigma_idx * cs]);
     }
     // Aimless >=0.7.6 (from 2021) has an option to output unmerged file
     // with original indices instead of reduced indices, with all ISYM = 1.
@@ -95,6 +95,8 @@ struct PdbReadOptions {
   int max_line_length = 0;
   bool split_chain_on_ter = false;
   bool skip_remarks = false;
+  // >1: read the file into memory and parse ATOM/HETATM records in parallel
+  int num_threads = 1;
 };
 // end of PdbReadOptions for mol.rst
 
@@ -91,11 +91,13 @@ struct GEMMI_DLL Mtz {
     const Dataset& dataset() const { return parent->dataset(dataset_id); }
     bool has_data() const { return parent->has_data(); }
     int size() const { return has_data() ? parent->nreflections : 0; }
-    size_t stride() const { return parent->columns.size(); }
-    float& operator[](std::size_t n) { return parent->data[idx + n * stride()]; }
-    float operator[](std::size_t n) const { return parent->data[idx + n * stride()]; }
-    float& at(std::size_t n) { return parent->data.at(idx + n * stride()); }
-    float at(std::size_t n) const { return parent->data.at(idx + n * stride()); }
+    size_t stride() const { return parent->row_step(); }
+    // position of the first value in parent->data
+    size_t offset() const { return idx * parent->column_step(); }
+    float& operator[](std::size_t n) { return parent->data[offset() + n * stride()]; }
+    float operator[](std::size_t n) const { return parent->data[offset() + n * stride()]; }
+    float& at(std::size_t n) { return parent->data.at(offset() + n * stride()); }
+    float at(std::size_t n) const { return parent->data.at(offset() + n * stride()); }
     bool is_integer() const {
       return type == 'H' || type == 'B' || type == 'Y' || type == 'I';
     }
@@ -113,9 +115,13 @@ struct GEMMI_DLL Mtz {
     iterator begin() {
       assert(parent);
       assert(&parent->columns[idx] == this);
+      if (parent->column_major)
+        return iterator({parent->data.data() + offset(), 0, 1});
       return iterator({parent->data.data(), idx, stride()});
     }
     iterator end() {
+      if (parent->column_major)
+        return iterator({parent->data.data() + offset() + size(), 0, 1});
       return iterator({parent->data.data() + parent->data.size(), idx,
                        stride()});
     }
@@ -190,6 +196,10 @@ struct GEMMI_DLL Mtz {
   std::vector<std::string> history;
   std::string appended_text;
   std::vector<float> data;
+  // Layout of data. Row-major (as in the file) by default; in column-major
+  // layout each column is contiguous, which makes per-column passes faster.
+  // Can be set before reading the data; then the data is transposed on read.
+  bool column_major = false;
 
   // stream used for warnings when reading mtz file (and also in mtz2cif)
   std::ostream* warnings = nullptr;
@@ -200,7 +210,9 @@ struct GEMMI_DLL Mtz {
   }
   Mtz(Mtz&& o) noexcept { *this = std::move(o); }
   Mtz& operator=(Mtz&& o) noexcept {
+    source_path = std::move(o.source_path);
     same_byte_order = o.same_byte_order;
+    indices_switched_to_original = o.indices_switched_to_original;
     header_offset = o.header_offset;
     version_stamp = std::move(o.version_stamp);
     title = std::move(o.title);
@@ -221,6 +233,7 @@ struct GEMMI_DLL Mtz {
     history = std::move(o.history);
     appended_text = std::move(o.appended_text);
     data = std::move(o.data);
+    column_major = o.column_major;
     warnings = o.warnings;
     for (Mtz::Column& col : columns)
       col.parent = this;
@@ -442,9 +455,33 @@ struct GEMMI_DLL Mtz {
 
   bool is_merged() const { return batches.empty(); }
 
+  // Distance in data between values from consecutive rows (reflections)
+  // and from consecutive columns; depends on the layout.
+  size_t row_step() const { return column_major ? 1 : columns.size(); }
+  size_t column_step() const { return column_major ? (size_t) nreflections : 1; }
+  size_t data_index(size_t row, size_t col) const {
+    return row * row_step() + col * column_step();
+  }
+
+  void switch_to_column_major() {
+    if (!column_major) {
+      transpose_data(true);
+      column_major = true;
+    }
+  }
+
+  void switch_to_row_major() {
+    if (column_major) {
+      transpose_data(false);
+      column_major = false;
+    }
+  }
+
   void extend_min_max_1_d2(const UnitCell& uc, double& min, double& max) const {
+    const size_t rs = row_step(), cs = column_step();
     for (size_t i = 0; i < data.size(); i += columns.size()) {
-      double res = uc.calculate_1_d2_double(data[i+0], data[i+1], data[i+2]);
+      size_t n = i / columns.size() * rs;
+      double res = uc.calculate_1_d2_double(data[n], data[n+cs], data[n+2*cs]);
       if (res < min)
         min = res;
       if (res > max)
@@ -753,6 +790,55 @@ struct GEMMI_DLL Mtz {
     if (!same_byte_order)
       for (float& f : data)
         swap_four_bytes(&f);
+    if (column_major)
+      transpose_data(true);
+  }
+
+  // Keeps only H, K, L and columns with the given labels (in the original
+  // order) and returns their positions in the file. Called after headers
+  // are read and before the data, to read a subset of columns.
+  std::vector<size_t> select_columns(const std::vector<std::string>& labels) {
+    for (const std::string& label : labels)
+      if (!column_with_label(label))
+        fail("Column label not found: " + label);
+    std::vector<size_t> positions;
+    std::vector<Column> selected;
+    for (size_t i = 0; i < columns.size(); ++i)
+      if (i < 3 || in_vector(columns[i].label, labels)) {
+        positions.push_back(i);
+        selected.push_back(std::move(columns[i]));
+        selected.back().idx = selected.size() - 1;
+      }
+    columns.swap(selected);
+    return positions;
+  }
+
+  // Reads only columns at given positions, a block of rows at a time,
+  // so that the full reflection table is never held in memory.
+  template<typename Stream>
+  void read_raw_data_columns(Stream& stream, const std::vector<size_t>& positions,
+                             size_t file_ncol) {
+    const size_t nrefl = (size_t) nreflections;
+    const size_t block_rows = 4096;
+    data.resize(positions.size() * nrefl);
+    if (!stream.seek(80))
+      fail("Cannot rewind to the MTZ data.");
+    std::vector<float> buf(std::min(block_rows, nrefl) * file_ncol);
+    const size_t rs = row_step(), cs = column_step();
+    for (size_t row = 0; row < nrefl; row += block_rows) {
+      size_t nrows = std::min(block_rows, nrefl - row);
+      if (!stream.read(buf.data(), 4 * nrows * file_ncol))
+        fail("Error when reading MTZ data");
+      for (size_t r = 0; r < nrows; ++r) {
+        const float* in = &buf[r * file_ncol];
+        float* out = &data[(row + r) * rs];
+        for (size_t i = 0; i < positions.size(); ++i)
+          out[i * cs] = in[positions[i]];
+      }
+    }
+    if (!same_byte_order)
+      for (float& f : data)
+        swap_four_bytes(&f);
   }
 
   template<typename Stream>
@@ -782,6 +868,26 @@ struct GEMMI_DLL Mtz {
     }
   }
 
+  // Like read_stream(), but only H, K, L and the listed columns are kept.
+  template<typename Stream>
+  void read_stream_columns(Stream&& stream, const std::vector<std::string>& labels) {
+    read_all_headers(stream);
+    size_t file_ncol = columns.size();
+    std::vector<size_t> positions = select_columns(labels);
+    read_raw_data_columns(stream, positions, file_ncol);
+  }
+
+  void read_file_columns(const std::string& path,
+                         const std::vector<std::string>& labels) {
+    fileptr_t f = file_open(path.c_str(), "rb");
+    try {
+      source_path = path;
+      read_stream_columns(FileStream{f.get()}, labels);
+    } catch (std::runtime_error& e) {
+      fail(std::string(e.what()) + ": " + path);
+    }
+  }
+
   template<typename Input>
   void read_input(Input&& input, bool with_data) {
     source_path = input.path();
@@ -806,12 +912,13 @@ struct GEMMI_DLL Mtz {
     std::vector<int> indices(nreflections);
     for (int i = 0; i != nreflections; ++i)
       indices[i] = i;
+    const size_t rs = row_step(), cs = column_step();
     std::stable_sort(indices.begin(), indices.end(), [&](int i, int j) {
-      int a = i * (int) columns.size();
-      int b = j * (int) columns.size();
-      for (int n = 0; n < use_first; ++n)
-        if (data[a+n] != data[b+n])
-          return data[a+n] < data[b+n];
+      size_t a = i * rs;
+      size_t b = j * rs;
+      for (int n = 0; n < use_first; ++n, a += cs, b += cs)
+        if (data[a] != data[b])
+          return data[a] < data[b];
       return false;
     });
     return indices;
@@ -824,6 +931,17 @@ struct GEMMI_DLL Mtz {
       sort_order[i] = i + 1;
     if (std::is_sorted(indices.begin(), indices.end()))
       return false;
+    if (column_major) {
+      // permute each column separately, using contiguous memory
+      std::vector<float> buf(nreflections);
+      for (size_t col = 0; col < columns.size(); ++col) {
+        float* values = &data[col * nreflections];
+        for (size_t i = 0; i != indices.size(); ++i)
+          buf[i] = values[indices[i]];
+        std::copy(buf.begin(), buf.end(), values);
+      }
+      return true;
+    }
     std::vector<float> new_data(data.size());
     size_t w = columns.size();
     for (size_t i = 0; i != indices.size(); ++i)
@@ -832,14 +950,24 @@ struct GEMMI_DLL Mtz {
     return true;
   }
 
+  // offset is row * columns.size(), regardless of the layout
   Miller get_hkl(size_t offset) const {
+    if (column_major) {
+      size_t row = offset / columns.size();
+      size_t nrefl = nreflections;
+      return {{(int)data[row], (int)data[row+nrefl], (int)data[row+2*nrefl]}};
+    }
     return {{(int)data[offset], (int)data[offset+1], (int)data[offset+2]}};
   }
   void set_hkl(size_t offset, const Miller& hkl) {
+    size_t pos = column_major ? offset / columns.size() : offset;
     for (int i = 0; i != 3; ++i)
-      data[offset + i] = static_cast<float>(hkl[i]);
+      data[pos + i * column_step()] = static_cast<float>(hkl[i]);
   }
 
+  // The functions below, implemented in src/mtz.cpp, as well as writing
+  // functions, require the row-major layout (call switch_to_row_major()).
+
   /// Returns offset of the first hkl or (size_t)-1. Can be slow.
   size_t find_offset_of_hkl(const Miller& hkl, size_t start=0) const;
 
@@ -927,9 +1055,15 @@ struct GEMMI_DLL Mtz {
     }
     if (src_mtz == this) {
       // internal copying
-      for (size_t n = 0; n < data.size(); n += columns.size())
-        for (size_t i = 0; i <= trailing_cols.size(); ++i)
-          data[n + dest_idx + i] = data[n + src_col.idx + i];
+      for (size_t i = 0; i <= trailing_cols.size(); ++i) {
+        Column& dst = columns[dest_idx + i];
+        const Column& src = columns[src_col.idx + i];
+        if (column_major)
+          std::copy(src.begin(), src.end(), dst.begin());
+        else
+          for (size_t n = 0; n < (size_t) nreflections; ++n)
+            dst[n] = src[n];
+      }
     } else {
       // external copying - need to match indices
       std::vector<int> dst_indices = sorted_row_indices();
@@ -945,8 +1079,8 @@ struct GEMMI_DLL Mtz {
         if (dst_hkl == src_hkl) {
           // copy values
           for (size_t i = 0; i <= trailing_cols.size(); ++i)
-            data[*dst * dst_stride + dest_idx + i] =
-              src_mtz->data[*src * src_stride + src_col.idx + i];
+            data[data_index(*dst, dest_idx + i)] =
+              src_mtz->data[src_mtz->data_index(*src, src_col.idx + i)];
           ++dst;
           ++src;
         } else if (dst_hkl < src_hkl) {
@@ -1000,16 +1134,43 @@ struct GEMMI_DLL Mtz {
     columns.erase(columns.begin() + idx);
     for (size_t i = idx; i < columns.size(); ++i)
       --columns[i].idx;
-    vector_remove_column(data, columns.size(), idx);
+    if (column_major)
+      data.erase(data.begin() + idx * nreflections,
+                 data.begin() + (idx + 1) * nreflections);
+    else
+      vector_remove_column(data, columns.size(), idx);
     assert(columns.size() * nreflections == data.size());
   }
 
+  // condition is called with a pointer to a row (in row-major layout)
   template <typename Func>
   void remove_rows_if(Func condition) {
     if (!has_data())
       fail("No data.");
-    auto out = data.begin();
     size_t width = columns.size();
+    if (column_major) {
+      std::vector<float> row(width);
+      size_t nrefl = nreflections;
+      size_t out = 0;
+      for (size_t r = 0; r < nrefl; ++r) {
+        for (size_t i = 0; i < width; ++i)
+          row[i] = data[i * nrefl + r];
+        if (!condition(row.data())) {
+          if (r != out)
+            for (size_t i = 0; i < width; ++i)
+              data[i * nrefl + out] = row[i];
+          ++out;
+        }
+      }
+      // compact the columns
+      for (size_t i = 1; i < width; ++i)
+        std::copy(data.begin() + i * nrefl, data.begin() + i * nrefl + out,
+                  data.begin() + i * out);
+      data.resize(out * width);
+      nreflections = int(out);
+      return;
+    }
+    auto out = data.begin();
     for (auto r = data.begin(); r < data.end(); r += width)
       if (!condition(&*r)) {
         if (r != out)
@@ -1027,7 +1188,10 @@ struct GEMMI_DLL Mtz {
     size_t pos = pos_ == -1 ? old_row_size : (size_t) pos_;
     if (pos > old_row_size)
       fail("expand_data_rows(): pos out of range");
-    vector_insert_columns(data, old_row_size, (size_t)nreflections, added, pos, NAN);
+    if (column_major)
+      data.insert(data.begin() + pos * nreflections, added * nreflections, NAN);
+    else
+      vector_insert_columns(data, old_row_size, (size_t)nreflections, added, pos, NAN);
   }
 
   void set_data(const float* new_data, size_t n) {
@@ -1036,15 +1200,41 @@ struct GEMMI_DLL Mtz {
       fail("Mtz.set_data(): expected " + std::to_string(ncols) + " columns.");
     nreflections = int(n / ncols);
     data.assign(new_data, new_data + n);
+    if (column_major)
+      transpose_data(true);
   }
 
-  // Function for writing MTZ file
+  // Function for writing MTZ file (requires the row-major layout)
   void write_to_cstream(std::FILE* stream) const;
   void write_to_string(std::string& str) const;
   void write_to_file(const std::string& path) const;
 
 private:
   template<typename Write> void write_to_stream(Write write) const;
+
+  // data converted between row-major and column-major layouts
+  std::vector<float> transposed_data(bool to_column_major) const {
+    size_t nrow = nreflections;
+    size_t ncol = columns.size();
+    if (data.size() != nrow * ncol)
+      return data;
+    std::vector<float> new_data(data.size());
+    if (to_column_major) {
+      for (size_t r = 0; r < nrow; ++r)
+        for (size_t c = 0; c < ncol; ++c)
+          new_data[c * nrow + r] = data[r * ncol + c];
+    } else {
+      for (size_t r = 0; r < nrow; ++r)
+        for (size_t c = 0; c < ncol; ++c)
+          new_data[r * ncol + c] = data[c * nrow + r];
+    }
+    return new_data;
+  }
+
+  void transpose_data(bool to_column_major) {
+    if (data.size() == columns.size() * nreflections)
+      data = transposed_data(to_column_major);
+  }
 };
 
 
@@ -1062,12 +1252,19 @@ Mtz read_mtz(Input&& input, bool with_data) {
 }
 
 // Abstraction of data source, cf. ReflnDataProxy.
+// Values are indexed as in row-major data (n = row * stride() + column)
+// with either layout of Mtz::data; column-major data is read with strides.
 struct MtzDataProxy {
   const Mtz& mtz_;
   size_t stride() const { return mtz_.columns.size(); }
   size_t size() const { return mtz_.data.size(); }
   using num_type = float;
-  float get_num(size_t n) const { return mtz_.data[n]; }
+  float get_num(size_t n) const {
+    if (!mtz_.column_major)
+      return mtz_.data[n];
+    size_t row = n / stride();
+    return mtz_.data[mtz_.data_index(row, n - row * stride())];
+  }
   const UnitCell& unit_cell() const { return mtz_.cell; }
   const SpaceGroup* spacegroup() const { return mtz_.spacegroup; }
   Miller get_hkl(size_t offset) const { return mtz_.get_hkl(offset); }
@@ -1080,6 +1277,7 @@ struct MtzDataProxy {
 };
 
 // Like above, but here the data is stored outside of the Mtz class
+// (always in the row-major layout, as in the file)
 struct MtzExternalDataProxy : MtzDataProxy {
   const float* data_;
   MtzExternalDataProxy(const Mtz& mtz, const float* data)
@@ -1095,6 +1293,77 @@ struct MtzExternalDataProxy : MtzDataProxy {
 
 inline MtzDataProxy data_proxy(const Mtz& mtz) { return {mtz}; }
 
+// Uncompressed MTZ file mapped into memory. Only headers are parsed into
+// mtz (mtz.data stays empty); reflections are accessed in place through
+// data(), column() or data_proxy(), without copying. If the file has
+// non-native byte order, the data is copied and byte-swapped.
+struct MappedMtz {
+  struct ColumnView {
+    const float* data_;
+    size_t idx;
+    size_t stride;
+    size_t n;
+    size_t size() const { return n; }
+    float operator[](size_t i) const { return data_[idx + i * stride]; }
+    StrideIter<const float> begin() const { return StrideIter<const float>({data_, idx, stride}); }
+    StrideIter<const float> end() const {
+      return StrideIter<const float>({data_ + n * stride, idx, stride});
+    }
+  };
+
+  Mtz mtz;
+  MappedFile file;
+  std::vector<float> swapped;  // used only for non-native byte order
+
+  size_t size() const { return mtz.columns.size() * mtz.nreflections; }
+  const float* data() const {
+    if (!mtz.same_byte_order)
+      return swapped.data();
+    return reinterpret_cast<const float*>(file.data() + 80);
+  }
+  MtzExternalDataProxy data_proxy() const { return {mtz, data()}; }
+
+  ColumnView column(const Mtz::Column& col) const {
+    return {data(), col.idx, mtz.columns.size(), (size_t) mtz.nreflections};
+  }
+  ColumnView column(const std::string& label) const {
+    return column(mtz.get_column_with_label(label));
+  }
+
+  // Copies H, K, L and the listed columns into a regular Mtz.
+  Mtz copy_columns(const std::vector<std::string>& labels) const {
+    Mtz out;
+    out.source_path = mtz.source_path;
+    out.warnings = mtz.warnings;
+    out.read_stream_columns(file.stream(), labels);
+    return out;
+  }
+};
+
+inline MappedMtz read_mtz_mmap(const std::string& path) {
+  MappedMtz m;
+  m.file.open(path);
+  m.mtz.source_path = path;
+  try {
+    MemoryStream stream = m.file.stream();
+    m.mtz.read_all_headers(stream);
+    size_t n = m.size();
+    if (80 + 4 * n > m.file.size())
+      fail("MTZ file is too short for " + std::to_string(m.mtz.nreflections) +
+           " reflections");
+    if (!m.mtz.same_byte_order) {
+      const char* start = m.file.data() + 80;
+      m.swapped.resize(n);
+      std::memcpy(m.swapped.data(), start, 4 * n);
+      for (float& f : m.swapped)
+        swap_four_bytes(&f);
+    }
+  } catch (std::runtime_error& e) {
+    fail(std::string(e.what()) + ": " + path);
+  }
+  return m;
+}
+
 } // namespace gemmi
 
 #endif
@@ -7,7 +7,12 @@
 #define GEMMI_NEIGHBOR_HPP_
 
 #include <vector>
-#include <cmath>  // for INFINITY, sqrt
+#include <algorithm>  // for min, max
+#include <cmath>  // for INFINITY, sqrt, fabs
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+# include <immintrin.h>
+#endif
 
 #include "fail.hpp"      // for fail
 #include "grid.hpp"
@@ -52,6 +57,13 @@ struct NeighborSearch {
   };
 
   Grid<std::vector<Mark>> grid;
+  // Compact mode (after populate_compact() or compact()): all marks are
+  // in one array sorted by cell, cell idx has compact_marks[cell_start[idx]]
+  // to compact_marks[cell_start[idx+1]-1] and the vectors in grid are empty.
+  // Positions are also stored as float arrays for the distance filter.
+  std::vector<Mark> compact_marks;
+  std::vector<int> cell_start;
+  std::vector<float> mark_x, mark_y, mark_z;
   double radius_specified = 0.;
   Model* model = nullptr;
   SmallStructure* small_structure = nullptr;
@@ -74,25 +86,44 @@ struct NeighborSearch {
   }
 
   NeighborSearch& populate(bool include_h_=true);
+  // populate() in compact mode, without building the per-cell vectors
+  NeighborSearch& populate_compact(bool include_h_=true);
+  // moves marks from the per-cell vectors to the compact arrays
+  NeighborSearch& compact();
+  bool is_compact() const { return !cell_start.empty(); }
   void add_chain(const Chain& chain, bool include_h_=true);
   void add_chain_n(const Chain& chain, int n_ch);
   void add_atom(const Atom& atom, int n_ch, int n_res, int n_atom);
   void add_site(const SmallStructure::Site& site, int n);
 
   // assumes data in [0, 1), but uses index_n to account for numerical errors
+  size_t subcell_index(const Fractional& fr) const {
+    return grid.index_n(int(fr.x * grid.nu), int(fr.y * grid.nv), int(fr.z * grid.nw));
+  }
   std::vector<Mark>& get_subcell(const Fractional& fr) {
-    return grid.data[grid.index_n(int(fr.x * grid.nu),
-                                  int(fr.y * grid.nv),
-                                  int(fr.z * grid.nw))];
+    return grid.data[subcell_index(fr)];
   }
 
+  // calls func(idx, fr) for subcells around pos; idx is an index to grid.data
   template<typename Func>
-  void for_each_cell(const Position& pos, const Func& func, int k=1);
+  void for_each_cell_index(const Position& pos, const Func& func, int k=1);
+
+  // the vectors passed to func are empty in compact mode
+  template<typename Func>
+  void for_each_cell(const Position& pos, const Func& func, int k=1) {
+    for_each_cell_index(pos, [&](size_t idx, const Fractional& fr) {
+        func(grid.data[idx], fr);
+    }, k);
+  }
 
   template<typename Func>
   void for_each(const Position& pos, char alt, double radius, const Func& func, int k=1) {
     if (radius <= 0)
       return;
+    if (is_compact()) {
+      for_each_compact(pos, alt, radius, func, k);
+      return;
+    }
     for_each_cell(pos, [&](std::vector<Mark>& marks, const Fractional& fr) {
         Position p = use_pbc ? grid.unit_cell.orthogonalize(fr) : pos;
         for (Mark& m : marks) {
@@ -125,6 +156,38 @@ struct NeighborSearch {
   std::vector<Mark*> find_neighbors(const Atom& atom, double min_dist, double max_dist) {
     return find_atoms(atom.pos, atom.altloc, min_dist, max_dist);
   }
+  // Batch version of find_atoms(): the atoms found for pos[i] are
+  // out[offsets[i]] to out[offsets[i+1]-1]. The output vectors can be
+  // reused between calls to avoid allocations.
+  void find_atoms_batch(const std::vector<Position>& pos, char alt,
+                        double min_dist, double radius,
+                        std::vector<int>& offsets, std::vector<Mark*>& out) {
+    int k = sufficient_k(radius);
+    if (radius == 0)
+      radius = radius_specified;
+    offsets.resize(pos.size() + 1);
+    out.clear();
+    for (size_t i = 0; i != pos.size(); ++i) {
+      offsets[i] = (int) out.size();
+      for_each(pos[i], alt, radius, [&](Mark& a, double dist_sq) {
+          if (dist_sq >= sq(min_dist))
+            out.push_back(&a);
+      }, k);
+    }
+    offsets[pos.size()] = (int) out.size();
+  }
+
+  // Batch version of for_each(): calls func(i, mark, dist_sq) for pos[i].
+  template<typename Func>
+  void for_each_batch(const std::vector<Position>& pos, char alt, double radius,
+                      const Func& func) {
+    int k = sufficient_k(radius);
+    for (size_t i = 0; i != pos.size(); ++i)
+      for_each(pos[i], alt, radius, [&](Mark& m, double dist_sq) {
+          func(i, m, dist_sq);
+      }, k);
+  }
+
   std::vector<Mark*> find_site_neighbors(const SmallStructure::Site& site,
                                          double min_dist, double max_dist) {
     Position pos = grid.unit_cell.orthogonalize(site.fract);
@@ -135,9 +198,12 @@ struct NeighborSearch {
   find_nearest_atom_within_k(const Position& pos, int k, double radius) {
     Mark* mark = nullptr;
     double nearest_dist_sq = radius * radius;
-    for_each_cell(pos, [&](std::vector<Mark>& marks, const Fractional& fr) {
+    for_each_cell_index(pos, [&](size_t idx, const Fractional& fr) {
         Position p = use_pbc ? grid.unit_cell.orthogonalize(fr) : pos;
-        for (Mark& m : marks) {
+        Mark* begin = cell_begin(idx);
+        Mark* end = cell_end(idx);
+        for (Mark* m_ = begin; m_ != end; ++m_) {
+          Mark& m = *m_;
           double dist_sq = m.pos.dist_sq(p);
           if (dist_sq < nearest_dist_sq) {
             mark = &m;
@@ -190,6 +256,87 @@ struct NeighborSearch {
   }
 
 private:
+  bool staging_ = false;             // populate_compact() in progress
+  std::vector<int> staged_cells_;    // subcell of each mark when staging_
+  float float_tol_ = 0.f;            // bound on float rounding of distances
+
+  Mark* cell_begin(size_t idx) {
+    return is_compact() ? compact_marks.data() + cell_start[idx]
+                        : grid.data[idx].data();
+  }
+  Mark* cell_end(size_t idx) {
+    return is_compact() ? compact_marks.data() + cell_start[idx+1]
+                        : grid.data[idx].data() + grid.data[idx].size();
+  }
+
+  void add_mark(const Fractional& frac, const Mark& mark) {
+    if (staging_) {
+      staged_cells_.push_back((int) subcell_index(frac));
+      compact_marks.push_back(mark);
+    } else {
+      if (is_compact())
+        fail("NeighborSearch: cannot add atoms after compact()");
+      get_subcell(frac).push_back(mark);
+    }
+  }
+
+  // sorts marks with subcells staged_cells_ into the compact arrays
+  void build_compact();
+
+  // out[i] = squared distance of mark i from (px,py,pz), using SIMD if available
+  static void dist_sq_row(const float* x, const float* y, const float* z, int n,
+                          float px, float py, float pz, float* out) {
+    int i = 0;
+#if defined(__AVX512F__)
+    for (; i + 16 <= n; i += 16) {
+      __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(x + i), _mm512_set1_ps(px));
+      __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(y + i), _mm512_set1_ps(py));
+      __m512 dz = _mm512_sub_ps(_mm512_loadu_ps(z + i), _mm512_set1_ps(pz));
+      __m512 d2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)),
+                                _mm512_mul_ps(dz, dz));
+      _mm512_storeu_ps(out + i, d2);
+    }
+#endif
+#if defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+      __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), _mm256_set1_ps(px));
+      __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), _mm256_set1_ps(py));
+      __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), _mm256_set1_ps(pz));
+      __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                _mm256_mul_ps(dz, dz));
+      _mm256_storeu_ps(out + i, d2);
+    }
+#endif
+    for (; i < n; ++i) {
+      float dx = x[i] - px, dy = y[i] - py, dz = z[i] - pz;
+      out[i] = dx * dx + dy * dy + dz * dz;
+    }
+  }
+
+  // Marks are first filtered with float distances, with a margin for
+  // rounding errors, and then tested exactly as in the non-compact mode.
+  template<typename Func>
+  void for_each_compact(const Position& pos, char alt, double radius, const Func& func, int k) {
+    const int chunk = 64;
+    float d2[chunk];
+    float r2f = float(sq(radius + float_tol_));
+    for_each_cell_index(pos, [&](size_t idx, const Fractional& fr) {
+        Position p = use_pbc ? grid.unit_cell.orthogonalize(fr) : pos;
+        for (int i = cell_start[idx]; i < cell_start[idx+1]; i += chunk) {
+          int n = std::min(chunk, cell_start[idx+1] - i);
+          dist_sq_row(&mark_x[i], &mark_y[i], &mark_z[i], n,
+                      (float) p.x, (float) p.y, (float) p.z, d2);
+          for (int j = 0; j < n; ++j)
+            if (d2[j] <= r2f) {
+              Mark& m = compact_marks[i + j];
+              double dist_sq = m.pos.dist_sq(p);
+              if (dist_sq < sq(radius) && is_same_conformer(alt, m.altloc))
+                func(m, dist_sq);
+            }
+        }
+    }, k);
+  }
+
   void set_grid_size() {
     // We don't use set_size_from_spacing() etc because we don't need
     // FFT-friendly size nor symmetry.
@@ -251,6 +398,76 @@ inline NeighborSearch& NeighborSearch::populate(bool include_h_) {
   return *this;
 }
 
+inline NeighborSearch& NeighborSearch::populate_compact(bool include_h_) {
+  // release the per-cell vectors left by an earlier populate()
+  for (std::vector<Mark>& cell : grid.data)
+    std::vector<Mark>().swap(cell);
+  compact_marks.clear();
+  cell_start.clear();
+  staged_cells_.clear();
+  staging_ = true;
+  try {
+    populate(include_h_);
+  } catch (...) {
+    staging_ = false;
+    throw;
+  }
+  staging_ = false;
+  build_compact();
+  return *this;
+}
+
+inline NeighborSearch& NeighborSearch::compact() {
+  if (is_compact())
+    return *this;
+  compact_marks.clear();
+  staged_cells_.clear();
+  for (size_t idx = 0; idx != grid.data.size(); ++idx) {
+    std::vector<Mark>& cell = grid.data[idx];
+    compact_marks.insert(compact_marks.end(), cell.begin(), cell.end());
+    staged_cells_.insert(staged_cells_.end(), cell.size(), (int) idx);
+    std::vector<Mark>().swap(cell);
+  }
+  build_compact();
+  return *this;
+}
+
+inline void NeighborSearch::build_compact() {
+  // counting sort; marks in the same cell keep their order
+  size_t ncell = grid.data.size();
+  cell_start.assign(ncell + 1, 0);
+  for (int idx : staged_cells_)
+    ++cell_start[idx + 1];
+  for (size_t i = 0; i != ncell; ++i)
+    cell_start[i + 1] += cell_start[i];
+  std::vector<int> next(cell_start.begin(), cell_start.end() - 1);
+  std::vector<size_t> order(compact_marks.size());
+  for (size_t i = 0; i != compact_marks.size(); ++i)
+    order[next[staged_cells_[i]]++] = i;
+  std::vector<Mark> sorted;
+  sorted.reserve(compact_marks.size());
+  mark_x.resize(compact_marks.size());
+  mark_y.resize(compact_marks.size());
+  mark_z.resize(compact_marks.size());
+  double max_abs = 0.;
+  for (size_t i = 0; i != order.size(); ++i) {
+    const Mark& m = compact_marks[order[i]];
+    sorted.push_back(m);
+    mark_x[i] = (float) m.pos.x;
+    mark_y[i] = (float) m.pos.y;
+    mark_z[i] = (float) m.pos.z;
+    max_abs = std::max(max_abs, std::max(std::fabs(m.pos.x),
+                                         std::max(std::fabs(m.pos.y), std::fabs(m.pos.z))));
+  }
+  compact_marks.swap(sorted);
+  std::vector<int>().swap(staged_cells_);
+  // coordinates of the marks and of the query point are rounded to float
+  // (relative error 2^-24 each); this is a generous bound on the effect
+  // on the distance, assuming query points not much further out than marks
+  float_tol_ = float(1e-6 * (max_abs + grid.unit_cell.a + grid.unit_cell.b
+                             + grid.unit_cell.c) + 1e-6);
+}
+
 inline void NeighborSearch::add_chain(const Chain& chain, bool include_h_) {
   if (!model)
     fail("NeighborSearch.add_chain(): model not initialized yet");
@@ -283,14 +500,14 @@ inline void NeighborSearch::add_atom(const Atom& atom,
     Fractional frac = frac0.wrap_to_unit();
     // for non-crystals, frac==frac0 => pos = atom.pos
     Position pos = use_pbc ? gcell.orthogonalize(frac) : atom.pos;
-    get_subcell(frac).emplace_back(pos, atom.altloc, atom.element.elem,
-                                   0, n_ch, n_res, n_atom);
+    add_mark(frac, Mark(pos, atom.altloc, atom.element.elem,
+                        0, n_ch, n_res, n_atom));
   }
   for (int n_im = 0; n_im != (int) gcell.images.size(); ++n_im) {
     Fractional frac = gcell.images[n_im].apply(frac0).wrap_to_unit();
     Position pos = gcell.orthogonalize(frac);
-    get_subcell(frac).emplace_back(pos, atom.altloc, atom.element.elem,
-                                   short(n_im + 1), n_ch, n_res, n_atom);
+    add_mark(frac, Mark(pos, atom.altloc, atom.element.elem,
+                        short(n_im + 1), n_ch, n_res, n_atom));
   }
 }
 
@@ -306,7 +523,7 @@ inline void NeighborSearch::add_site(const SmallStructure::Site& site, int n) {
   Fractional frac0 = site.fract.wrap_to_unit();
   {
     Position pos = gcell.orthogonalize(frac0);
-    get_subcell(frac0).emplace_back(pos, '\0', site.element.elem, 0, -1, -1, n);
+    add_mark(frac0, Mark(pos, '\0', site.element.elem, 0, -1, -1, n));
   }
   for (int n_im = 0; n_im != (int) gcell.images.size(); ++n_im) {
     Fractional frac = gcell.images[n_im].apply(site.fract).wrap_to_unit();
@@ -316,14 +533,14 @@ inline void NeighborSearch::add_site(const SmallStructure::Site& site, int n) {
         }))
       continue;
     Position pos = gcell.orthogonalize(frac);
-    get_subcell(frac).emplace_back(pos, '\0', site.element.elem,
-                                   short(n_im + 1), -1, -1, n);
+    add_mark(frac, Mark(pos, '\0', site.element.elem,
+                        short(n_im + 1), -1, -1, n));
     others.push_back(frac);
   }
 }
 
 template<typename Func>
-void NeighborSearch::for_each_cell(const Position& pos, const Func& func, int k) {
+void NeighborSearch::for_each_cell_index(const Position& pos, const Func& func, int k) {
   Fractional fr = grid.unit_cell.fractionalize(pos);
   if (use_pbc)
     fr = fr.wrap_to_unit();
@@ -349,7 +566,7 @@ void NeighborSearch::for_each_cell(const Position& pos, const Func& func, int k)
         for (int u = u0; u < uend; ++u) {
           int du = shift(u, grid.nu);
           size_t idx = idx0 + (u - du * grid.nu);
-          func(grid.data[idx], Fractional(fr.x - du, fr.y - dv, fr.z - dw));
+          func(idx, Fractional(fr.x - du, fr.y - dv, fr.z - dw));
         }
       }
     }
@@ -364,7 +581,7 @@ void NeighborSearch::for_each_cell(const Position& pos, const Func& func, int k)
       for (int v = v0; v < vend; ++v)
         for (int u = u0; u < uend; ++u) {
           size_t idx = grid.index_q(u, v, w);
-          func(grid.data[idx], fr);
+          func(idx, fr);
         }
   }
 }
@@ -18,6 +18,9 @@
 #include <cstdio>     // for stdin, size_t
 #include <cstdlib>    // for strtol
 #include <cstring>    // for memcpy, strstr, strchr
+#include <exception>  // for exception_ptr
+#include <system_error>
+#include <thread>
 #include <unordered_map>
 
 #include "fileutil.hpp" // for path_basename, file_open
@@ -214,9 +217,192 @@ void process_conn(Structure& st, const std::vector<std::string>& conn_records) {
   }
 }
 
+inline void read_atom_fields(const char* line, size_t len, Atom& atom) {
+  atom.serial = read_serial(line+6);
+  atom.name = read_string(line+12, 4);
+  atom.altloc = read_altloc(line[16]);
+  atom.pos.x = read_double(line+30, 8);
+  atom.pos.y = read_double(line+38, 8);
+  atom.pos.z = read_double(line+46, 8);
+  if (len > 58)
+    atom.occ = (float) read_double(line+54, 6);
+  if (len > 64)
+    atom.b_iso = (float) read_double(line+60, 6);
+  if (len > 76 && (std::isalpha(line[76]) || std::isalpha(line[77])))
+    atom.element = Element(line + 76);
+  // Atom names HXXX are ambiguous, but Hg, He, Hf, Ho and Hs (almost)
+  // never have 4-character names, so H is assumed.
+  else if (alpha_up(line[12]) == 'H' && line[15] != ' ')
+    atom.element = El::H;
+  // Similarly Deuterium (DXXX), but here alternatives are Dy, Db and Ds.
+  // Only Dysprosium is present in the PDB - in a single entry as of 2022.
+  else if (alpha_up(line[12]) == 'D' && line[15] != ' ')
+    atom.element = El::D;
+  // Old versions of the PDB format had hydrogen names such as "1HB ".
+  // Some MD files use similar names for other elements ("1C4A" -> C).
+  else if (is_digit(line[12]))
+    atom.element = impl::find_single_letter_element(line[13]);
+  // ... or it can be "C210"
+  else if (is_digit(line[13]))
+    atom.element = impl::find_single_letter_element(line[12]);
+  else
+    atom.element = Element(line + 12);
+  atom.charge = (len > 78 ? read_charge(line[78], line[79]) : 0);
+}
+
+// ATOM/HETATM record parsed in advance, possibly in another thread.
+struct StagedAtom {
+  std::string chain_name;
+  ResidueId rid;  // including segment
+  Atom atom;
+  bool ok;        // false if parsing failed; the line is then parsed again
+  bool new_model; // MODEL or ENDMDL since the previous record in this part
+};
+
+// ATOM/HETATM records from consecutive parts of the file, in the file order
+struct StagedAtoms {
+  std::vector<std::vector<StagedAtom>> parts;
+  size_t part = 0;
+  size_t pos = 0;
+
+  // the next record, or nullptr if none is left
+  StagedAtom* next() {
+    while (part < parts.size() && pos == parts[part].size()) {
+      ++part;
+      pos = 0;
+    }
+    return part < parts.size() ? &parts[part][pos++] : nullptr;
+  }
+
+  // The counts below are taken from the records after the one returned
+  // by next(), up to the next model. They are used only to reserve vectors.
+
+  // number of following chains (changes of the chain name)
+  size_t chains_ahead(const std::string& chain_name) const {
+    size_t n = 0;
+    const std::string* prev = &chain_name;
+    for_each_ahead([&](const StagedAtom& sa) {
+      if (sa.chain_name != *prev) {
+        ++n;
+        prev = &sa.chain_name;
+      }
+      return true;
+    });
+    return n;
+  }
+  // number of following residues in the same chain
+  size_t residues_ahead(const std::string& chain_name, const ResidueId& rid) const {
+    size_t n = 0;
+    const ResidueId* prev = &rid;
+    for_each_ahead([&](const StagedAtom& sa) {
+      if (sa.chain_name != chain_name)
+        return false;
+      if (!(sa.rid == *prev)) {
+        ++n;
+        prev = &sa.rid;
+      }
+      return true;
+    });
+    return n;
+  }
+  // number of following atoms in the same residue
+  size_t atoms_ahead(const std::string& chain_name, const ResidueId& rid) const {
+    size_t n = 0;
+    for_each_ahead([&](const StagedAtom& sa) {
+      if (sa.chain_name != chain_name || !(sa.rid == rid))
+        return false;
+      ++n;
+      return true;
+    });
+    return n;
+  }
+
+private:
+  // calls func(record) until it returns false or a record starts a new model
+  template<typename Func> void for_each_ahead(Func func) const {
+    for (size_t p = part, i = pos; p < parts.size(); ++p, i = 0)
+      for (; i < parts[p].size(); ++i) {
+        const StagedAtom& sa = parts[p][i];
+        if (!sa.ok || sa.new_model || !func(sa))
+          return;
+      }
+  }
+};
+
+// Parses ATOM/HETATM records from the buffer using num_threads threads.
+// The buffer is split at line ends and each thread parses lines from its
+// part in the same way as read_pdb_from_stream().
+inline StagedAtoms stage_atoms(const char* data, size_t size,
+                               int max_line_length, int num_threads) {
+  std::vector<size_t> split(num_threads + 1, size);
+  split[0] = 0;
+  for (int t = 1; t < num_threads; ++t) {
+    size_t pos = std::max(split[t-1], size * t / num_threads);
+    const char* nl = pos < size ? (const char*) std::memchr(data + pos, '\n', size - pos)
+                                : nullptr;
+    split[t] = nl ? nl - data + 1 : size;
+  }
+  StagedAtoms staged;
+  staged.parts.resize(num_threads);
+  auto work = [&](int t) {
+    MemoryStream stream(data + split[t], split[t+1] - split[t]);
+    std::vector<StagedAtom>& out = staged.parts[t];
+    out.reserve((split[t+1] - split[t]) / 81);
+    char line[122] = {0};
+    bool new_model = false;
+    while (size_t len = copy_line_from_stream(line, max_line_length+1, stream)) {
+      if ((is_record_type(line, "ATOM") || is_record_type(line, "HETATM")) && len >= 55) {
+        out.emplace_back();
+        StagedAtom& sa = out.back();
+        sa.new_model = new_model;
+        new_model = false;
+        try {
+          sa.chain_name = read_string(line+20, 2);
+          sa.rid = read_res_id(line+22, line+17);
+          if (len > 72)
+            sa.rid.segment = read_string(line+72, 4);
+          read_atom_fields(line, len, sa.atom);
+          sa.ok = true;
+        } catch (std::exception&) {
+          sa.ok = false;
+        }
+      } else if (is_record_type(line, "MODEL") || is_record_type(line, "ENDMDL")) {
+        new_model = true;
+      }
+    }
+  };
+  std::vector<std::exception_ptr> errors(num_threads);
+  auto run = [&](int t) {
+    try {
+      work(t);
+    } catch (...) {
+      errors[t] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  int started = 1;
+  try {
+    for (; started < num_threads; ++started)
+      threads.emplace_back(run, started);
+  } catch (const std::system_error&) {
+    // a thread could not be started; the remaining parts are parsed here
+  }
+  run(0);
+  for (int t = started; t < num_threads; ++t)
+    run(t);
+  for (std::thread& thread : threads)
+    thread.join();
+  for (const std::exception_ptr& error : errors)
+    if (error)
+      std::rethrow_exception(error);
+  return staged;
+}
+
 template<typename Stream>
 Structure read_pdb_from_stream(Stream&& stream, const std::string& source,
-                               const PdbReadOptions& options) {
+                               const PdbReadOptions& options,
+                               StagedAtoms* staged=nullptr) {
   int line_num = 0;
   auto wrong = [&line_num](const std::string& msg) {
     fail("Problem in line " + std::to_string(line_num) + ": " + msg);
@@ -240,8 +426,18 @@ Structure read_pdb_from_stream(Stream&& stream, const std::string& source,
     if (is_record_type(line, "ATOM") || is_record_type(line, "HETATM")) {
       if (len < 55)
         wrong("The line is too short to be correct:\n" + std::string(line));
-      std::string chain_name = read_string(line+20, 2);
-      ResidueId rid = read_res_id(line+22, line+17);
+      StagedAtom* staged_atom = staged ? staged->next() : nullptr;
+      if (staged_atom && !staged_atom->ok)
+        staged_atom = nullptr;
+      std::string chain_name;
+      ResidueId rid;
+      if (staged_atom) {
+        chain_name.swap(staged_atom->chain_name);
+        rid = std::move(staged_atom->rid);
+      } else {
+        chain_name = read_string(line+20, 2);
+        rid = read_res_id(line+22, line+17);
+      }
 
       if (!chain || chain_name != chain->name) {
         if (!model) {
@@ -256,15 +452,19 @@ Structure read_pdb_from_stream(Stream&& stream, const std::string& source,
         const Chain* prev_part = model->find_chain(chain_name);
         after_ter = prev_part &&
                     prev_part->residues[0].entity_type == EntityType::Polymer;
+        if (staged_atom && model->chains.empty())
+          model->chains.reserve(1 + staged->chains_ahead(chain_name));
         model->chains.emplace_back(chain_name);
         chain = &model->chains.back();
+        if (staged_atom)
+          chain->residues.reserve(1 + staged->residues_ahead(chain_name, rid));
         resmap.clear();
         resi = nullptr;
       }
       // Non-standard but widely used 4-character segment identifier.
       // Left-justified, and may include a space in the middle.
       // The segment may be a portion of a chain or a complete chain.
-      if (len > 72)
+      if (len > 72 && !staged_atom)
         rid.segment = read_string(line+72, 4);
       if (!resi || !resi->matches(rid)) {
         auto it = resmap.find(rid);
@@ -276,6 +476,8 @@ Structure read_pdb_from_stream(Stream&& stream, const std::string& source,
           resmap.emplace(rid, (int) chain->residues.size());
           chain->residues.emplace_back(rid);
           resi = &chain->residues.back();
+          if (staged_atom)
+            resi->atoms.reserve(1 + staged->atoms_ahead(chain_name, rid));
 
           resi->het_flag = line[0] & ~0x20;
           if (after_ter)
@@ -286,38 +488,13 @@ Structure read_pdb_from_stream(Stream&& stream, const std::string& source,
         }
       }
 
-      Atom atom;
-      atom.serial = read_serial(line+6);
-      atom.name = read_string(line+12, 4);
-      atom.altloc = read_altloc(line[16]);
-      atom.pos.x = read_double(line+30, 8);
-      atom.pos.y = read_double(line+38, 8);
-      atom.pos.z = read_double(line+46, 8);
-      if (len > 58)
-        atom.occ = (float) read_double(line+54, 6);
-      if (len > 64)
-        atom.b_iso = (float) read_double(line+60, 6);
-      if (len > 76 && (std::isalpha(line[76]) || std::isalpha(line[77])))
-        atom.element = Element(line + 76);
-      // Atom names HXXX are ambiguous, but Hg, He, Hf, Ho and Hs (almost)
-      // never have 4-character names, so H is assumed.
-      else if (alpha_up(line[12]) == 'H' && line[15] != ' ')
-        atom.element = El::H;
-      // Similarly Deuterium (DXXX), but here alternatives are Dy, Db and Ds.
-      // Only Dysprosium is present in the PDB - in a single entry as of 2022.
-      else if (alpha_up(line[12]) == 'D' && line[15] != ' ')
-        atom.element = El::D;
-      // Old versions of the PDB format had hydrogen names such as "1HB ".
-      // Some MD files use similar names for other elements ("1C4A" -> C).
-      else if (is_digit(line[12]))
-        atom.element = impl::find_single_letter_element(line[13]);
-      // ... or it can be "C210"
-      else if (is_digit(line[13]))
-        atom.element = impl::find_single_letter_element(line[12]);
-      else
-        atom.element = Element(line + 12);
-      atom.charge = (len > 78 ? read_charge(line[78], line[79]) : 0);
-      resi->atoms.emplace_back(atom);
+      if (staged_atom) {
+        resi->atoms.emplace_back(std::move(staged_atom->atom));
+      } else {
+        Atom atom;
+        read_atom_fields(line, len, atom);
+        resi->atoms.emplace_back(atom);
+      }
 
     } else if (is_record_type(line, "ANISOU")) {
       if (!model || !chain || !resi || resi->atoms.empty())
@@ -671,18 +848,30 @@ Structure read_pdb_from_stream(Stream&& stream, const std::string& source,
 
 }  // namespace pdb_impl
 
-inline Structure read_pdb_file(const std::string& path,
-                               PdbReadOptions options=PdbReadOptions()) {
-  auto f = file_open(path.c_str(), "rb");
-  return pdb_impl::read_pdb_from_stream(FileStream{f.get()}, path, options);
-}
-
 inline Structure read_pdb_from_memory(const char* data, size_t size,
                                       const std::string& name,
                                       PdbReadOptions options=PdbReadOptions()) {
+  if (options.num_threads > 1) {
+    int max_line_length = options.max_line_length;
+    if (max_line_length <= 0 || max_line_length > 120)
+      max_line_length = 120;
+    pdb_impl::StagedAtoms staged =
+      pdb_impl::stage_atoms(data, size, max_line_length, options.num_threads);
+    return pdb_impl::read_pdb_from_stream(MemoryStream(data, size), name, options, &staged);
+  }
   return pdb_impl::read_pdb_from_stream(MemoryStream(data, size), name, options);
 }
 
+inline Structure read_pdb_file(const std::string& path,
+                               PdbReadOptions options=PdbReadOptions()) {
+  if (options.num_threads > 1) {
+    CharArray mem = read_file_into_buffer(path);
+    return read_pdb_from_memory(mem.data(), mem.size(), path, options);
+  }
+  auto f = file_open(path.c_str(), "rb");
+  return pdb_impl::read_pdb_from_stream(FileStream{f.get()}, path, options);
+}
+
 inline Structure read_pdb_string(const std::string& str,
                                  const std::string& name,
                                  PdbReadOptions options=PdbReadOptions()) {
@@ -694,9 +883,14 @@ template<typename T>
 inline Structure read_pdb(T&& input, PdbReadOptions options=PdbReadOptions()) {
   if (input.is_stdin())
     return pdb_impl::read_pdb_from_stream(FileStream{stdin}, "stdin", options);
-  if (input.is_compressed())
+  if (input.is_compressed()) {
+    if (options.num_threads > 1) {
+      CharArray mem = input.uncompress_into_buffer();
+      return read_pdb_from_memory(mem.data(), mem.size(), input.path(), options);
+    }
     return pdb_impl::read_pdb_from_stream(input.get_uncompressing_stream(),
                                           input.path(), options);
+  }
   return read_pdb_file(input.path(), options);
 }
 
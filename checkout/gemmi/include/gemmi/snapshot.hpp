@@ -0,0 +1,637 @@
+// Copyright 2026 Global Phasing Ltd.
+//
+// Binary snapshot of Structure - a cache format for fast reloading.
+// The file has a header (magic, version, byte order, checksum, counts)
+// followed by arrays of fixed-size records and a string table.
+// Reading is a bulk read (or mmap) plus the copying of strings.
+// Stored: models, chains, residues, atoms, entities, connections,
+// unit cell, space group, resolution and Structure::info.
+// Not stored: other metadata (Structure::meta, ncs, helices, etc).
+
+#ifndef GEMMI_SNAPSHOT_HPP_
+#define GEMMI_SNAPSHOT_HPP_
+
+#include <cstdint>
+#include <cstring>     // for memcpy, memcmp
+#include <string>
+#include <vector>
+#include "fail.hpp"      // for fail
+#include "fileutil.hpp"  // for file_open, MappedFile
+#include "model.hpp"
+
+namespace gemmi {
+
+namespace snapshot_impl {
+
+static const char magic[8] = {'G', 'E', 'M', 'M', 'I', 'S', 'N', 'P'};
+static const std::uint32_t version = 2;
+static const std::uint32_t byte_order_mark = 0x01020304;
+
+// string stored in the string table
+struct Str {
+  std::uint32_t offset;
+  std::uint32_t length;
+};
+
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint64_t payload_size;
+  std::uint64_t checksum;  // of the payload
+  std::uint32_t n_models, n_chains, n_residues, n_atoms;
+  std::uint32_t n_entities, n_dbrefs, n_connections, n_info;
+  std::uint32_t n_strlist;  // lists of strings in entities
+  std::uint32_t strings_size;
+};
+
+struct StructureRec {
+  Str name, spacegroup_hm;
+  double cell[6];
+  double frac[12];  // used only if explicit_matrices is set
+  double resolution;
+  std::int32_t input_format;
+  char ter_status;
+  std::uint8_t has_d_fraction;
+  std::uint8_t explicit_matrices;
+  std::uint8_t pad_;
+};
+
+struct ModelRec {
+  Str name;
+  std::uint32_t n_chains;
+  std::uint32_t pad_;
+};
+
+struct ChainRec {
+  Str name;
+  std::uint32_t n_residues;
+  std::uint32_t pad_;
+};
+
+struct ResidueRec {
+  Str segment, name, subchain, entity_id;
+  std::int32_t seqnum;
+  std::int32_t label_seq;
+  std::uint32_t n_atoms;
+  char icode;
+  std::uint8_t entity_type;
+  char het_flag;
+  char flag;
+  char sifts_res;
+  std::uint8_t sifts_acc_index;
+  std::uint16_t sifts_num;
+  std::uint32_t pad_;
+};
+
+struct AtomRec {
+  Str name;
+  char altloc;
+  signed char charge;
+  std::uint8_t element;
+  signed char calc_flag;
+  char flag;
+  char pad_;
+  std::int16_t tls_group_id;
+  std::int32_t serial;
+  float fraction;
+  double pos[3];
+  float occ;
+  float b_iso;
+  float aniso[6];
+};
+
+struct EntityRec {
+  Str name;
+  std::uint8_t entity_type;
+  std::uint8_t polymer_type;
+  std::uint16_t pad_;
+  // numbers of strings in the following lists (consecutive in strlist)
+  std::uint32_t n_subchains, n_sifts_unp_acc, n_full_sequence;
+  std::uint32_t n_dbrefs;
+  std::uint32_t pad2_;
+};
+
+struct DbRefRec {
+  Str db_name, accession_code, id_code, isoform;
+  std::int32_t seq_begin, seq_end, db_begin, db_end;
+  char seq_begin_icode, seq_end_icode, db_begin_icode, db_end_icode;
+  std::int32_t label_seq_begin, label_seq_end;
+  std::uint32_t pad_;
+};
+
+struct AddressRec {
+  Str chain_name, segment, res_name, atom_name;
+  std::int32_t seqnum;
+  char icode;
+  char altloc;
+  std::uint16_t pad_;
+};
+
+struct ConnectionRec {
+  Str name, link_id;
+  AddressRec partner1, partner2;
+  double reported_distance;
+  std::uint8_t type;
+  std::uint8_t asu;
+  std::uint8_t pad_[6];
+};
+
+struct InfoRec {
+  Str key, value;
+};
+
+// the layout is part of the file format
+static_assert(sizeof(Header) == 72 && sizeof(StructureRec) == 176 &&
+              sizeof(ModelRec) == 16 && sizeof(ChainRec) == 16 &&
+              sizeof(ResidueRec) == 56 && sizeof(AtomRec) == 80 &&
+              sizeof(EntityRec) == 32 && sizeof(DbRefRec) == 64 &&
+              sizeof(ConnectionRec) == 112 && sizeof(InfoRec) == 16,
+              "unexpected size of snapshot records");
+
+inline size_t padded8(size_t n) { return (n + 7) & ~size_t(7); }
+
+// Hash of 64-bit words, using the round and the final avalanche
+// of xxHash64, so that every bit of input affects all bits of output.
+// Size must be a multiple of 8.
+inline std::uint64_t checksum(const char* data, size_t size) {
+  const std::uint64_t p1 = 0x9e3779b185ebca87, p2 = 0xc2b2ae3d27d4eb4f;
+  std::uint64_t h = 0x27d4eb2f165667c5 + size;
+  for (size_t i = 0; i + 8 <= size; i += 8) {
+    std::uint64_t w;
+    std::memcpy(&w, data + i, 8);
+    h += w * p2;
+    h = (h << 31) | (h >> 33);
+    h *= p1;
+  }
+  h ^= h >> 33;
+  h *= p2;
+  h ^= h >> 29;
+  h *= 0x165667b19e3779f9;
+  h ^= h >> 32;
+  return h;
+}
+
+struct Writer {
+  std::vector<StructureRec> structure{1};
+  std::vector<ModelRec> models;
+  std::vector<ChainRec> chains;
+  std::vector<ResidueRec> residues;
+  std::vector<AtomRec> atoms;
+  std::vector<EntityRec> entities;
+  std::vector<DbRefRec> dbrefs;
+  std::vector<ConnectionRec> connections;
+  std::vector<InfoRec> info;
+  std::vector<Str> strlist;
+  std::string strings;
+
+  Str add(const std::string& s) {
+    if (strings.size() + s.size() > UINT32_MAX)
+      fail("snapshot: too much text");
+    Str r{(std::uint32_t) strings.size(), (std::uint32_t) s.size()};
+    strings += s;
+    return r;
+  }
+
+  AddressRec address(const AtomAddress& a) {
+    AddressRec r;
+    std::memset(&r, 0, sizeof(r));
+    r.chain_name = add(a.chain_name);
+    r.segment = add(a.res_id.segment);
+    r.res_name = add(a.res_id.name);
+    r.atom_name = add(a.atom_name);
+    r.seqnum = a.res_id.seqid.num.value;
+    r.icode = a.res_id.seqid.icode;
+    r.altloc = a.altloc;
+    return r;
+  }
+
+  template<typename T>
+  static void append(std::vector<char>& out, const std::vector<T>& v) {
+    if (!v.empty()) {
+      const char* p = reinterpret_cast<const char*>(v.data());
+      out.insert(out.end(), p, p + v.size() * sizeof(T));
+    }
+  }
+};
+
+template<typename T>
+void zero(T& rec) { std::memset(&rec, 0, sizeof(T)); }
+
+class Reader {
+public:
+  Reader(const char* data, size_t size) : ptr_(data), end_(data + size) {}
+
+  template<typename T>
+  T next() {
+    if (end_ - ptr_ < (std::ptrdiff_t) sizeof(T))
+      fail("snapshot is truncated");
+    T rec;
+    std::memcpy(&rec, ptr_, sizeof(T));
+    ptr_ += sizeof(T);
+    return rec;
+  }
+  const char* skip(size_t n) {
+    if ((size_t)(end_ - ptr_) < n)
+      fail("snapshot is truncated");
+    const char* p = ptr_;
+    ptr_ += n;
+    return p;
+  }
+private:
+  const char* ptr_;
+  const char* end_;
+};
+
+} // namespace snapshot_impl
+
+// Serializes Structure into a byte array (header + payload).
+inline std::vector<char> make_snapshot(const Structure& st) {
+  using namespace snapshot_impl;
+  Writer w;
+  StructureRec& sr = w.structure[0];
+  zero(sr);
+  sr.name = w.add(st.name);
+  sr.spacegroup_hm = w.add(st.spacegroup_hm);
+  const UnitCell& cell = st.cell;
+  const double params[6] = {cell.a, cell.b, cell.c, cell.alpha, cell.beta, cell.gamma};
+  std::memcpy(sr.cell, params, sizeof(params));
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      sr.frac[4*i+j] = cell.frac.mat[i][j];
+    sr.frac[4*i+3] = cell.frac.vec.at(i);
+  }
+  sr.resolution = st.resolution;
+  sr.input_format = (std::int32_t) st.input_format;
+  sr.ter_status = st.ter_status;
+  sr.has_d_fraction = st.has_d_fraction;
+  sr.explicit_matrices = cell.explicit_matrices;
+
+  for (const Model& model : st.models) {
+    w.models.emplace_back();
+    ModelRec& mr = w.models.back();
+    zero(mr);
+    mr.name = w.add(model.name);
+    mr.n_chains = (std::uint32_t) model.chains.size();
+    for (const Chain& chain : model.chains) {
+      w.chains.emplace_back();
+      ChainRec& cr = w.chains.back();
+      zero(cr);
+      cr.name = w.add(chain.name);
+      cr.n_residues = (std::uint32_t) chain.residues.size();
+      for (const Residue& res : chain.residues) {
+        w.residues.emplace_back();
+        ResidueRec& rr = w.residues.back();
+        zero(rr);
+        rr.segment = w.add(res.segment);
+        rr.name = w.add(res.name);
+        rr.subchain = w.add(res.subchain);
+        rr.entity_id = w.add(res.entity_id);
+        rr.seqnum = res.seqid.num.value;
+        rr.label_seq = res.label_seq.value;
+        rr.n_atoms = (std::uint32_t) res.atoms.size();
+        rr.icode = res.seqid.icode;
+        rr.entity_type = (std::uint8_t) res.entity_type;
+        rr.het_flag = res.het_flag;
+        rr.flag = res.flag;
+        rr.sifts_res = res.sifts_unp.res;
+        rr.sifts_acc_index = res.sifts_unp.acc_index;
+        rr.sifts_num = res.sifts_unp.num;
+        for (const Atom& atom : res.atoms) {
+          w.atoms.emplace_back();
+          AtomRec& ar = w.atoms.back();
+          zero(ar);
+          ar.name = w.add(atom.name);
+          ar.altloc = atom.altloc;
+          ar.charge = atom.charge;
+          ar.element = (std::uint8_t) atom.element.elem;
+          ar.calc_flag = (signed char) atom.calc_flag;
+          ar.flag = atom.flag;
+          ar.tls_group_id = atom.tls_group_id;
+          ar.serial = atom.serial;
+          ar.fraction = atom.fraction;
+          ar.pos[0] = atom.pos.x;
+          ar.pos[1] = atom.pos.y;
+          ar.pos[2] = atom.pos.z;
+          ar.occ = atom.occ;
+          ar.b_iso = atom.b_iso;
+          const SMat33<float>& u = atom.aniso;
+          const float aniso[6] = {u.u11, u.u22, u.u33, u.u12, u.u13, u.u23};
+          std::memcpy(ar.aniso, aniso, sizeof(aniso));
+        }
+      }
+    }
+  }
+
+  for (const Entity& ent : st.entities) {
+    w.entities.emplace_back();
+    EntityRec& er = w.entities.back();
+    zero(er);
+    er.name = w.add(ent.name);
+    er.entity_type = (std::uint8_t) ent.entity_type;
+    er.polymer_type = (std::uint8_t) ent.polymer_type;
+    er.n_subchains = (std::uint32_t) ent.subchains.size();
+    er.n_sifts_unp_acc = (std::uint32_t) ent.sifts_unp_acc.size();
+    er.n_full_sequence = (std::uint32_t) ent.full_sequence.size();
+    er.n_dbrefs = (std::uint32_t) ent.dbrefs.size();
+    for (const std::string& s : ent.subchains)
+      w.strlist.push_back(w.add(s));
+    for (const std::string& s : ent.sifts_unp_acc)
+      w.strlist.push_back(w.add(s));
+    for (const std::string& s : ent.full_sequence)
+      w.strlist.push_back(w.add(s));
+    for (const Entity::DbRef& dbref : ent.dbrefs) {
+      w.dbrefs.emplace_back();
+      DbRefRec& dr = w.dbrefs.back();
+      zero(dr);
+      dr.db_name = w.add(dbref.db_name);
+      dr.accession_code = w.add(dbref.accession_code);
+      dr.id_code = w.add(dbref.id_code);
+      dr.isoform = w.add(dbref.isoform);
+      dr.seq_begin = dbref.seq_begin.num.value;
+      dr.seq_end = dbref.seq_end.num.value;
+      dr.db_begin = dbref.db_begin.num.value;
+      dr.db_end = dbref.db_end.num.value;
+      dr.seq_begin_icode = dbref.seq_begin.icode;
+      dr.seq_end_icode = dbref.seq_end.icode;
+      dr.db_begin_icode = dbref.db_begin.icode;
+      dr.db_end_icode = dbref.db_end.icode;
+      dr.label_seq_begin = dbref.label_seq_begin.value;
+      dr.label_seq_end = dbref.label_seq_end.value;
+    }
+  }
+
+  for (const Connection& con : st.connections) {
+    w.connections.emplace_back();
+    ConnectionRec& cr = w.connections.back();
+    zero(cr);
+    cr.name = w.add(con.name);
+    cr.link_id = w.add(con.link_id);
+    cr.partner1 = w.address(con.partner1);
+    cr.partner2 = w.address(con.partner2);
+    cr.reported_distance = con.reported_distance;
+    cr.type = (std::uint8_t) con.type;
+    cr.asu = (std::uint8_t) con.asu;
+  }
+
+  for (const auto& item : st.info)
+    w.info.push_back({w.add(item.first), w.add(item.second)});
+
+  std::vector<char> out(sizeof(Header));
+  Writer::append(out, w.structure);
+  Writer::append(out, w.models);
+  Writer::append(out, w.chains);
+  Writer::append(out, w.residues);
+  Writer::append(out, w.atoms);
+  Writer::append(out, w.entities);
+  Writer::append(out, w.dbrefs);
+  Writer::append(out, w.connections);
+  Writer::append(out, w.info);
+  Writer::append(out, w.strlist);
+  out.insert(out.end(), w.strings.begin(), w.strings.end());
+  out.resize(padded8(out.size()), '\0');
+
+  Header h;
+  zero(h);
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.version = version;
+  h.byte_order = byte_order_mark;
+  h.payload_size = out.size() - sizeof(Header);
+  h.checksum = checksum(out.data() + sizeof(Header), (size_t) h.payload_size);
+  h.n_models = (std::uint32_t) w.models.size();
+  h.n_chains = (std::uint32_t) w.chains.size();
+  h.n_residues = (std::uint32_t) w.residues.size();
+  h.n_atoms = (std::uint32_t) w.atoms.size();
+  h.n_entities = (std::uint32_t) w.entities.size();
+  h.n_dbrefs = (std::uint32_t) w.dbrefs.size();
+  h.n_connections = (std::uint32_t) w.connections.size();
+  h.n_info = (std::uint32_t) w.info.size();
+  h.n_strlist = (std::uint32_t) w.strlist.size();
+  h.strings_size = (std::uint32_t) w.strings.size();
+  std::memcpy(out.data(), &h, sizeof(Header));
+  return out;
+}
+
+inline void write_snapshot(const Structure& st, const std::string& path) {
+  std::vector<char> data = make_snapshot(st);
+  fileptr_t f = file_open(path.c_str(), "wb");
+  if (std::fwrite(data.data(), data.size(), 1, f.get()) != 1)
+    sys_fail("Failed to write " + path);
+}
+
+inline bool is_snapshot(const char* data, size_t size) {
+  return size >= sizeof(snapshot_impl::Header) &&
+         std::memcmp(data, snapshot_impl::magic, sizeof(snapshot_impl::magic)) == 0;
+}
+
+// The data is not referenced after the function returns.
+inline Structure read_snapshot_from_memory(const char* data, size_t size,
+                                           const std::string& source) {
+  using namespace snapshot_impl;
+  if (!is_snapshot(data, size))
+    fail(source + ": not a gemmi snapshot");
+  Header h;
+  std::memcpy(&h, data, sizeof(Header));
+  if (h.byte_order != byte_order_mark)
+    fail(source + ": snapshot was written with different byte order");
+  if (h.version != version)
+    fail(source + ": unsupported snapshot version " + std::to_string(h.version));
+  if (h.payload_size != size - sizeof(Header))
+    fail(source + ": snapshot size mismatch");
+  const char* payload = data + sizeof(Header);
+  if (checksum(payload, (size_t) h.payload_size) != h.checksum)
+    fail(source + ": snapshot checksum mismatch");
+
+  Reader r(payload, (size_t) h.payload_size);
+  StructureRec sr = r.next<StructureRec>();
+  const char* recs = r.skip(size_t(h.n_models) * sizeof(ModelRec) +
+                            size_t(h.n_chains) * sizeof(ChainRec) +
+                            size_t(h.n_residues) * sizeof(ResidueRec) +
+                            size_t(h.n_atoms) * sizeof(AtomRec) +
+                            size_t(h.n_entities) * sizeof(EntityRec) +
+                            size_t(h.n_dbrefs) * sizeof(DbRefRec) +
+                            size_t(h.n_connections) * sizeof(ConnectionRec) +
+                            size_t(h.n_info) * sizeof(InfoRec) +
+                            size_t(h.n_strlist) * sizeof(Str));
+  const char* strings = r.skip(h.strings_size);
+  r = Reader(recs, strings - recs);
+  auto str = [&](const Str& s) {
+    if (s.offset > h.strings_size || s.length > h.strings_size - s.offset)
+      fail(source + ": corrupted snapshot");
+    return std::string(strings + s.offset, s.length);
+  };
+  // the counts of children must add up to the number of records
+  auto take = [&](std::uint32_t n, std::uint32_t& left) {
+    if (n > left)
+      fail(source + ": corrupted snapshot");
+    left -= n;
+    return n;
+  };
+
+  Structure st;
+  st.name = str(sr.name);
+  st.spacegroup_hm = str(sr.spacegroup_hm);
+  st.cell.set(sr.cell[0], sr.cell[1], sr.cell[2], sr.cell[3], sr.cell[4], sr.cell[5]);
+  if (sr.explicit_matrices) {
+    Transform frac;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j)
+        frac.mat[i][j] = sr.frac[4*i+j];
+      frac.vec.at(i) = sr.frac[4*i+3];
+    }
+    st.cell.set_matrices_from_fract(frac);
+  }
+  st.resolution = sr.resolution;
+  st.input_format = (CoorFormat) sr.input_format;
+  st.ter_status = sr.ter_status;
+  st.has_d_fraction = sr.has_d_fraction != 0;
+
+  std::uint32_t chains_left = h.n_chains;
+  std::uint32_t residues_left = h.n_residues;
+  std::uint32_t atoms_left = h.n_atoms;
+  std::vector<ModelRec> model_recs(h.n_models);
+  for (ModelRec& mr : model_recs)
+    mr = r.next<ModelRec>();
+  const char* chain_ptr = r.skip(size_t(h.n_chains) * sizeof(ChainRec));
+  const char* residue_ptr = r.skip(size_t(h.n_residues) * sizeof(ResidueRec));
+  const char* atom_ptr = r.skip(size_t(h.n_atoms) * sizeof(AtomRec));
+  Reader chain_reader(chain_ptr, residue_ptr - chain_ptr);
+  Reader residue_reader(residue_ptr, atom_ptr - residue_ptr);
+  Reader atom_reader(atom_ptr, size_t(h.n_atoms) * sizeof(AtomRec));
+  st.models.reserve(model_recs.size());
+  for (const ModelRec& mr : model_recs) {
+    st.models.emplace_back(str(mr.name));
+    Model& model = st.models.back();
+    model.chains.reserve(take(mr.n_chains, chains_left));
+    for (std::uint32_t ic = 0; ic != mr.n_chains; ++ic) {
+      ChainRec cr = chain_reader.next<ChainRec>();
+      model.chains.emplace_back(str(cr.name));
+      Chain& chain = model.chains.back();
+      chain.residues.resize(take(cr.n_residues, residues_left));
+      for (Residue& res : chain.residues) {
+        ResidueRec rr = residue_reader.next<ResidueRec>();
+        res.seqid.num.value = rr.seqnum;
+        res.seqid.icode = rr.icode;
+        res.segment = str(rr.segment);
+        res.name = str(rr.name);
+        res.subchain = str(rr.subchain);
+        res.entity_id = str(rr.entity_id);
+        res.label_seq.value = rr.label_seq;
+        res.entity_type = (EntityType) rr.entity_type;
+        res.het_flag = rr.het_flag;
+        res.flag = rr.flag;
+        res.sifts_unp.res = rr.sifts_res;
+        res.sifts_unp.acc_index = rr.sifts_acc_index;
+        res.sifts_unp.num = rr.sifts_num;
+        res.atoms.resize(take(rr.n_atoms, atoms_left));
+        for (Atom& atom : res.atoms) {
+          AtomRec ar = atom_reader.next<AtomRec>();
+          atom.name = str(ar.name);
+          atom.altloc = ar.altloc;
+          atom.charge = ar.charge;
+          if (ar.element > (std::uint8_t) El::D)
+            fail(source + ": corrupted snapshot");
+          atom.element = Element((El) ar.element);
+          atom.calc_flag = (CalcFlag) ar.calc_flag;
+          atom.flag = ar.flag;
+          atom.tls_group_id = ar.tls_group_id;
+          atom.serial = ar.serial;
+          atom.fraction = ar.fraction;
+          atom.pos = Position(ar.pos[0], ar.pos[1], ar.pos[2]);
+          atom.occ = ar.occ;
+          atom.b_iso = ar.b_iso;
+          atom.aniso = {ar.aniso[0], ar.aniso[1], ar.aniso[2],
+                        ar.aniso[3], ar.aniso[4], ar.aniso[5]};
+        }
+      }
+    }
+  }
+  if (chains_left != 0 || residues_left != 0 || atoms_left != 0)
+    fail(source + ": corrupted snapshot");
+
+  std::vector<EntityRec> entity_recs(h.n_entities);
+  for (EntityRec& er : entity_recs)
+    er = r.next<EntityRec>();
+  std::vector<DbRefRec> dbref_recs(h.n_dbrefs);
+  for (DbRefRec& dr : dbref_recs)
+    dr = r.next<DbRefRec>();
+  std::vector<ConnectionRec> connection_recs(h.n_connections);
+  for (ConnectionRec& cr : connection_recs)
+    cr = r.next<ConnectionRec>();
+  std::vector<InfoRec> info_recs(h.n_info);
+  for (InfoRec& ir : info_recs)
+    ir = r.next<InfoRec>();
+  std::uint32_t strlist_left = h.n_strlist;
+  std::uint32_t dbrefs_left = h.n_dbrefs;
+  auto read_strings = [&](std::uint32_t n, std::vector<std::string>& v) {
+    v.reserve(take(n, strlist_left));
+    for (std::uint32_t i = 0; i != n; ++i)
+      v.push_back(str(r.next<Str>()));
+  };
+
+  st.entities.reserve(entity_recs.size());
+  const DbRefRec* dr = dbref_recs.data();
+  for (const EntityRec& er : entity_recs) {
+    st.entities.emplace_back(str(er.name));
+    Entity& ent = st.entities.back();
+    ent.entity_type = (EntityType) er.entity_type;
+    ent.polymer_type = (PolymerType) er.polymer_type;
+    read_strings(er.n_subchains, ent.subchains);
+    read_strings(er.n_sifts_unp_acc, ent.sifts_unp_acc);
+    read_strings(er.n_full_sequence, ent.full_sequence);
+    ent.dbrefs.resize(take(er.n_dbrefs, dbrefs_left));
+    for (Entity::DbRef& dbref : ent.dbrefs) {
+      dbref.db_name = str(dr->db_name);
+      dbref.accession_code = str(dr->accession_code);
+      dbref.id_code = str(dr->id_code);
+      dbref.isoform = str(dr->isoform);
+      dbref.seq_begin = SeqId(dr->seq_begin, dr->seq_begin_icode);
+      dbref.seq_end = SeqId(dr->seq_end, dr->seq_end_icode);
+      dbref.db_begin = SeqId(dr->db_begin, dr->db_begin_icode);
+      dbref.db_end = SeqId(dr->db_end, dr->db_end_icode);
+      dbref.label_seq_begin.value = dr->label_seq_begin;
+      dbref.label_seq_end.value = dr->label_seq_end;
+      ++dr;
+    }
+  }
+  if (strlist_left != 0 || dbrefs_left != 0)
+    fail(source + ": corrupted snapshot");
+
+  auto address = [&](const AddressRec& a) {
+    AtomAddress addr;
+    addr.chain_name = str(a.chain_name);
+    addr.res_id.seqid = SeqId(a.seqnum, a.icode);
+    addr.res_id.segment = str(a.segment);
+    addr.res_id.name = str(a.res_name);
+    addr.atom_name = str(a.atom_name);
+    addr.altloc = a.altloc;
+    return addr;
+  };
+  st.connections.resize(connection_recs.size());
+  for (size_t i = 0; i != connection_recs.size(); ++i) {
+    const ConnectionRec& cr = connection_recs[i];
+    Connection& con = st.connections[i];
+    con.name = str(cr.name);
+    con.link_id = str(cr.link_id);
+    con.type = (Connection::Type) cr.type;
+    con.asu = (Asu) cr.asu;
+    con.partner1 = address(cr.partner1);
+    con.partner2 = address(cr.partner2);
+    con.reported_distance = cr.reported_distance;
+  }
+
+  for (const InfoRec& ir : info_recs)
+    st.info.emplace(str(ir.key), str(ir.value));
+
+  st.setup_cell_images();
+  return st;
+}
+
+// The file is memory-mapped (read into a buffer on Windows).
+inline Structure read_snapshot(const std::string& path) {
+  MappedFile file(path);
+  return read_snapshot_from_memory(file.data(), file.size(), path);
+}
+
+} // namespace gemmi
+#endif
@@ -59,8 +59,8 @@ py::array_t<float> make_new_column(const Mtz& mtz, int dataset, F f) {
   py::buffer_info buf = arr.request();
   float* ptr = (float*) buf.ptr;
   for (int i = 0; i < mtz.nreflections; ++i) {
-    int hidx = (int) mtz.columns.size() * i;
-    ptr[i] = f(cell, mtz.data[hidx], mtz.data[hidx+1], mtz.data[hidx+2]);
+    Miller hkl = mtz.get_hkl(mtz.columns.size() * i);
+    ptr[i] = f(cell, (float) hkl[0], (float) hkl[1], (float) hkl[2]);
   }
   return arr;
 }
@@ -98,14 +98,18 @@ void add_mtz(py::module& m) {
       int ncol = (int) self.columns.size();
       return py::buffer_info(self.data.data(),
                              {nrow, ncol}, // dimensions
-                             {4 * ncol, 4});  // strides
+                             {4 * self.row_step(), 4 * self.column_step()});  // strides
     })
     .def_property_readonly("array", [](const Mtz& self) {
       int nrow = self.has_data() ? self.nreflections : 0;
       int ncol = (int) self.columns.size();
-      return py::array_t<float>({nrow, ncol}, {4 * ncol, 4},
+      return py::array_t<float>({nrow, ncol},
+                                {4 * self.row_step(), 4 * self.column_step()},
                                 self.data.data(), py::cast(self));
     }, py::return_value_policy::reference_internal)
+    .def_readonly("column_major", &Mtz::column_major)
+    .def("switch_to_column_major", &Mtz::switch_to_column_major)
+    .def("switch_to_row_major", &Mtz::switch_to_row_major)
     .def_readwrite("title", &Mtz::title)
     .def_readwrite("nreflections", &Mtz::nreflections)
     .def_readwrite("sort_order", &Mtz::sort_order)
@@ -152,7 +156,7 @@ void add_mtz(py::module& m) {
         int* ptr = (int*) buf.ptr;
         for (int i = 0; i < self.nreflections; ++i)
           for (int j = 0; j != 3; ++j)
-            ptr[3*i + j] = (int) self.data[self.columns.size() * i + j];
+            ptr[3*i + j] = (int) self.data[self.data_index(i, j)];
         return arr;
     })
     .def("make_1_d2_array", &make_1_d2_array, py::arg("dataset")=-1)
@@ -235,21 +239,21 @@ void add_mtz(py::module& m) {
     .def("set_data", [](Mtz& self, const AsuData<std::complex<float>>& asu_data) {
          if (self.columns.size() != 5)
            fail("Mtz.set_data(): Mtz must have 5 columns to put H,K,L,F,Phi.");
-         self.nreflections = (int) asu_data.v.size();
-         self.data.clear();
-         add_asu_f_phi_to_float_vector(self.data, asu_data);
+         std::vector<float> data;
+         add_asu_f_phi_to_float_vector(data, asu_data);
+         self.set_data(data.data(), data.size());
     }, py::arg("asu_data"))
     .def("set_data", [](Mtz& self, const AsuData<float>& asu_data) {
          if (self.columns.size() != 4)
            fail("Mtz.set_data(): Mtz must have 4 columns.");
-         self.nreflections = (int) asu_data.v.size();
-         self.data.clear();
-         self.data.reserve(self.data.size() + asu_data.v.size() * 4);
+         std::vector<float> data;
+         data.reserve(asu_data.v.size() * 4);
          for (const auto& item : asu_data.v) {
            for (int i = 0; i != 3; ++i)
-             self.data.push_back((float) item.hkl[i]);
-           self.data.push_back(item.value);
+             data.push_back((float) item.hkl[i]);
+           data.push_back(item.value);
          }
+         self.set_data(data.data(), data.size());
     }, py::arg("asu_data"))
     .def("set_data", [](Mtz& self, py::array_t<float> arr) {
          if (arr.ndim() != 2)
@@ -264,27 +268,47 @@ void add_mtz(py::module& m) {
          auto r = arr.unchecked<2>();
          for (py::ssize_t row = 0; row < nrow; row++)
            for (py::ssize_t col = 0; col < ncol; col++)
-             self.data[row*ncol+col] = r(row, col);
+             self.data[self.data_index(row, col)] = r(row, col);
     }, py::arg("array"))
     .def("update_reso", &Mtz::update_reso)
     .def("sort", &Mtz::sort, py::arg("use_first")=3)
-    .def("ensure_asu", &Mtz::ensure_asu, py::arg("tnt_asu")=false)
-    .def("switch_to_original_hkl", &Mtz::switch_to_original_hkl)
-    .def("switch_to_asu_hkl", &Mtz::switch_to_asu_hkl)
-    .def("write_to_file", &Mtz::write_to_file, py::arg("path"))
+    // functions below need the row-major layout, so they switch to it
+    .def("ensure_asu", [](Mtz& self, bool tnt_asu) {
+        self.switch_to_row_major();
+        self.ensure_asu(tnt_asu);
+    }, py::arg("tnt_asu")=false)
+    .def("switch_to_original_hkl", [](Mtz& self) {
+        self.switch_to_row_major();
+        return self.switch_to_original_hkl();
+    })
+    .def("switch_to_asu_hkl", [](Mtz& self) {
+        self.switch_to_row_major();
+        return self.switch_to_asu_hkl();
+    })
+    .def("write_to_file", [](Mtz& self, const std::string& path) {
+        self.switch_to_row_major();
+        self.write_to_file(path);
+    }, py::arg("path"))
     .def("reindex", [](Mtz& self, const Op& op) {
+        self.switch_to_row_major();
         std::ostringstream out;
         self.reindex(op, &out);
         return out.str();
     }, py::arg("op"))
-    .def("expand_to_p1", &Mtz::expand_to_p1)
+    .def("expand_to_p1", [](Mtz& self) {
+        self.switch_to_row_major();
+        self.expand_to_p1();
+    })
     // handy for testing, but slow and can't handle duplicated column names
     .def("row_as_dict", [](const Mtz& self, const Miller& hkl) {
-        size_t offset = self.find_offset_of_hkl(hkl);
         py::dict data;
-        if (offset != (size_t)-1)
-          for (const Mtz::Column& column : self.columns)
-            data[column.label.c_str()] = self.data[offset++];
+        if (self.has_data() && self.columns.size() >= 3)
+          for (size_t n = 0; n < self.data.size(); n += self.columns.size())
+            if (self.get_hkl(n) == hkl) {
+              for (const Mtz::Column& column : self.columns)
+                data[column.label.c_str()] = column[n / self.columns.size()];
+              break;
+            }
         return data;
     }, py::arg("hkl"))
     .def("__repr__", [](const Mtz& self) {
@@ -303,13 +327,13 @@ void add_mtz(py::module& m) {
     ;
   pyMtzColumn
     .def_buffer([](Mtz::Column& self) {
-      return py::buffer_info(self.parent->data.data() + self.idx,
+      return py::buffer_info(self.parent->data.data() + self.offset(),
                              std::vector<py::ssize_t>(1, self.size()), // dimensions
                              {4 * self.stride()});  // strides
     })
     .def_property_readonly("array", [](const Mtz::Column& self) {
       return py::array_t<float>({self.size()}, {4 * self.stride()},
-                                self.parent->data.data() + self.idx,
+                                self.parent->data.data() + self.offset(),
                                 py::cast(self));
     }, py::return_value_policy::reference_internal)
     .def_property_readonly("dataset",
@@ -12,6 +12,7 @@
 #include "gemmi/chemcomp_xyz.hpp"  // for make_structure_from_chemcomp_block
 #include "gemmi/read_cif.hpp"      // for read_cif_gz, read_mmjson_gz
 #include "gemmi/mmread_gz.hpp"     // for read_structure_gz
+#include "gemmi/snapshot.hpp"      // for read_snapshot
 
 #include "common.h"
 #include <pybind11/stl.h>
@@ -74,6 +75,9 @@ void add_read_structure(py::module& m) {
           return new Structure(read_pdb_gz(path, options));
         }, py::arg("filename"), py::arg("max_line_length")=0,
            py::arg("split_chain_on_ter")=false);
+  m.def("read_snapshot", [](const std::string& path) {
+          return new Structure(read_snapshot(path));
+        }, py::arg("path"), "Reads a file written by Structure.write_snapshot().");
 
   // from smcif.hpp
   m.def("read_small_structure", [](const std::string& path) {
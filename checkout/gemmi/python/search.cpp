@@ -84,6 +84,7 @@ void add_search(py::module& m) {
     .def_readwrite("twice", &ContactSearch::twice)
     .def_readwrite("special_pos_cutoff_sq", &ContactSearch::special_pos_cutoff_sq)
     .def_readwrite("min_occupancy", &ContactSearch::min_occupancy)
+    .def_readwrite("num_threads", &ContactSearch::num_threads)
     .def("setup_atomic_radii", &ContactSearch::setup_atomic_radii)
     .def("get_radius", [](const ContactSearch& self, Element el) {
         return self.get_radius(el.elem);
@@ -38,6 +38,7 @@ void add_dencalc(py::module& m, const char* name) {
     .def_readwrite("rate", &DenCalc::rate)
     .def_readwrite("blur", &DenCalc::blur)
     .def_readwrite("cutoff", &DenCalc::cutoff)
+    .def_readwrite("num_threads", &DenCalc::num_threads)
     .def_readwrite("addends", &DenCalc::addends)
     .def("set_refmac_compatible_blur", &DenCalc::set_refmac_compatible_blur)
     .def("put_model_density_on_grid", &DenCalc::put_model_density_on_grid)
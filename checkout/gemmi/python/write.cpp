@@ -4,6 +4,7 @@
 #include "gemmi/to_mmcif.hpp"
 #include "gemmi/to_pdb.hpp"
 #include "gemmi/fstream.hpp"
+#include "gemmi/snapshot.hpp"
 
 #include "common.h"
 
@@ -135,5 +136,12 @@ void add_write(py::module& m, py::class_<Structure>& structure) {
     .def("update_mmcif_block", &update_mmcif_block, py::arg("block"),
          py::arg_v("groups", MmcifOutputGroups(true), "MmcifOutputGroups(True)"))
     .def("make_mmcif_headers", &make_mmcif_headers)
+    .def("write_snapshot", [](const Structure& st, const std::string& path) {
+       write_snapshot(st, path);
+    }, py::arg("path"))
+    .def("make_snapshot", [](const Structure& st) {
+       std::vector<char> data = make_snapshot(st);
+       return py::bytes(data.data(), data.size());
+    })
     ;
 }
@@ -39,6 +39,9 @@
 /* stuff for error reporting */
 #define CMTZ_ERRNO(n) (CCP4_ERR_MTZ | (n))
 
+/* Number of reflections read by one call in MtzGet */
+#define MTZ_READ_BLOCK 4096
+
 /* error defs */
 #define  CMTZERR_Ok                  0
 #define  CMTZERR_NoChannel           1
@@ -91,7 +94,7 @@ MTZ *MtzGetUserCellTolerance(const char *logname, int read_refs, const double ce
   float min,max,totcell[6],minres,maxres;
   float *refldata;
   double coefhkl[6];
-  int k; long xmllen;
+  int k, nblock, nrows; long xmllen;
   int32_t tmp_hdrst;
   int64_t hdrst;
 
@@ -887,12 +890,19 @@ MTZ *MtzGetUserCellTolerance(const char *logname, int read_refs, const double ce
 
   if (read_refs) {
 
-    refldata = (float *) ccp4_utils_malloc(ntotcol*sizeof(float));
-    /* Read all reflections into memory - make this optional? */
-    for (i = 0; i < mtz->nref_filein; ++i) {
-      MtzRrefl(filein, ntotcol, refldata);
-      for (j = 0; j < ntotcol; ++j)
-        colin[j]->ref[i] = refldata[j];
+    /* Read all reflections into memory - make this optional?
+       Reflections are read MTZ_READ_BLOCK rows at a time, and each
+       block is transposed into the column arrays. */
+    nblock = mtz->nref_filein < MTZ_READ_BLOCK ? mtz->nref_filein : MTZ_READ_BLOCK;
+    refldata = (float *) ccp4_utils_malloc((nblock > 0 ? nblock : 1)*ntotcol*sizeof(float));
+    for (i = 0; i < mtz->nref_filein; i += nblock) {
+      nrows = mtz->nref_filein - i < nblock ? mtz->nref_filein - i : nblock;
+      MtzRreflBlock(filein, ntotcol, nrows, refldata);
+      for (j = 0; j < ntotcol; ++j) {
+        float *ref = colin[j]->ref + i;
+        for (k = 0; k < nrows; ++k)
+          ref[k] = refldata[k*ntotcol + j];
+      }
     }
     free(refldata);
 
@@ -1002,6 +1012,12 @@ int MtzRrefl(CCP4File *filein, int ncol, float *refldata) {
   return istat;
 }
 
+int MtzRreflBlock(CCP4File *filein, int ncol, int nrefl, float *refldata) {
+
+  ccp4_file_setmode(filein,2);
+  return ccp4_file_read(filein, (uint8 *) refldata, ncol*nrefl);
+}
+
 int MtzFindInd(const MTZ *mtz, int *ind_xtal, int *ind_set, int ind_col[3]) {
 
   int i,j,k;
@@ -149,6 +149,16 @@ MTZ *MtzGetUserCellTolerance(const char *logname, int read_refs, const double ce
  */
 int MtzRrefl(CCP4File *filein, int ncol, float *refldata);
 
+/** Reads a block of reflections from MTZ file with a single call
+ * to ccp4_file_read.
+ * @param filein pointer to input file
+ * @param ncol number of columns in each reflection
+ * @param nrefl number of reflections to read
+ * @param refldata array of reflection data, ncol*nrefl values, row by row
+ * @return istat from ccp4_file_read
+ */
+int MtzRreflBlock(CCP4File *filein, int ncol, int nrefl, float *refldata);
+
 /** Writes an MTZ data structure to disk. If file is already open, MtzPut
  * uses file pointer in mtz struct, else uses logical name of file.
  * @param mtz pointer to MTZ struct.